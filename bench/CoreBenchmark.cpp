@@ -0,0 +1,418 @@
+#include <QCoreApplication>
+#include <QImage>
+#include <QTemporaryDir>
+#include <QVector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "DiodeSyncService.h"
+#include "FrameParser.h"
+#include "KeyboardControllerProtocol.h"
+#include "LoopbackDevice.h"
+#include "LoopbackHarness.h"
+#include "PinMatrix.h"
+#include "ProjectIO.h"
+#include "SerialPortModel.h"
+#include "logger.h"
+
+namespace
+{
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+struct AllocationCount
+{
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+AllocationCount allocationsNow()
+{
+    return {g_allocations.load(std::memory_order_relaxed), g_allocatedBytes.load(std::memory_order_relaxed)};
+}
+
+// Every replaced allocation function counts and goes through malloc, every deallocation function goes through
+// free. Kept out of line so GCC does not pair an inlined free() with operator new (-Wmismatched-new-delete).
+[[gnu::noinline]] void* countedAlloc(std::size_t size, std::size_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    size = size ? size : 1;
+
+    // aligned_alloc wants the size to be a multiple of the alignment
+    void* ptr = alignment > alignof(std::max_align_t)
+                    ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                    : std::malloc(size);
+    if (ptr)
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void countedFree(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAlloc(size, 0);
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAlloc(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+namespace
+{
+
+volatile uint64_t g_sink = 0;
+
+// Set when a benchmark that checks its result got a wrong one
+bool g_failed = false;
+
+// body() performs ops operations, everything it needs is set up by the caller
+template <typename Body>
+void measure(const char* name, size_t ops, Body&& body)
+{
+    const AllocationCount before  = allocationsNow();
+    const auto            start   = std::chrono::steady_clock::now();
+    body();
+    const auto            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const AllocationCount after   = allocationsNow();
+
+    const double allocations = static_cast<double>(after.allocations - before.allocations);
+    const double bytes       = static_cast<double>(after.bytes - before.bytes);
+
+    std::printf("%-30s %9zu ops %10.1f ns/op %9.3f allocs/op %11.1f bytes/op\n",
+                name,
+                ops,
+                elapsed * 1e9 / ops,
+                allocations / ops,
+                bytes / ops);
+}
+
+std::vector<uint8_t> buildStatusStream(size_t frames)
+{
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; i < frames; ++i)
+    {
+        const uint8_t        ledsNum = static_cast<uint8_t>(i % 16);
+        std::vector<uint8_t> payload{static_cast<uint8_t>(1 + i % 15), static_cast<uint8_t>(1 + i % 15), ledsNum};
+        for (uint8_t led = 0; led < ledsNum; ++led)
+        {
+            const Pins pins = PinMatrix::pinsAt(led);
+            payload.push_back(pins.pin1);
+            payload.push_back(pins.pin2);
+        }
+
+        const auto frame = build_packet(Command::StatusUpdate, payload.data(), payload.size());
+        stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+    return stream;
+}
+
+void benchProtocol()
+{
+    constexpr size_t kOps = 1000000;
+
+    uint8_t frame[64];
+    for (size_t i = 0; i < sizeof(frame); ++i)
+    {
+        frame[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    measure("calc_checksum (64 bytes)",
+            kOps,
+            [&]()
+            {
+                for (size_t i = 0; i < kOps; ++i)
+                {
+                    frame[0] = static_cast<uint8_t>(i);
+                    g_sink += calc_checksum(frame, sizeof(frame));
+                }
+            });
+
+    const Pins pins{3, 7};
+    measure("build_packet (pins)",
+            kOps,
+            [&]()
+            {
+                for (size_t i = 0; i < kOps; ++i)
+                {
+                    g_sink += build_packet(Command::ButtonPressed, &pins.pin1, sizeof(pins)).back();
+                }
+            });
+
+    measure("build_sequenced_packet (pins)",
+            kOps,
+            [&]()
+            {
+                for (size_t i = 0; i < kOps; ++i)
+                {
+                    const auto seq = static_cast<uint8_t>(i);
+                    g_sink += build_sequenced_packet(Command::ButtonPressed, seq, &pins.pin1, sizeof(pins)).back();
+                }
+            });
+}
+
+void benchFrameParser()
+{
+    constexpr size_t kFrames    = 200000;
+    constexpr size_t kChunkSize = 64;
+
+    const auto stream = buildStatusStream(kFrames);
+    FrameParser parser;
+
+    measure("FrameParser feed+drain",
+            kFrames,
+            [&]()
+            {
+                size_t pos = 0;
+                while (pos < stream.size())
+                {
+                    const size_t chunk = std::min(kChunkSize, stream.size() - pos);
+                    pos += parser.feed(stream.data() + pos, chunk);
+                    parser.drain([](std::span<const uint8_t> frame) { g_sink += frame.size(); });
+                }
+            });
+}
+
+void expectDeviceDiodes(const LoopbackDevice& device, size_t expected)
+{
+    const size_t actual = device.simulator().diodes().count();
+    if (actual != expected)
+    {
+        std::fprintf(stderr, "Device diode table has %zu diodes, expected %zu\n", actual, expected);
+        g_failed = true;
+    }
+}
+
+// End to end over a loopback link to the firmware model: every command is queued, written,
+// acknowledged and applied, the table the device ends up with is checked after each run
+void benchDiodeSync()
+{
+    constexpr size_t kResets  = 2000;
+    constexpr size_t kUpdates = 20000;
+
+    LoopbackDevice   device;
+    SerialPortModel  model;
+    DiodeSyncService sync(&model);
+
+    if (!connectTo(device, model))
+    {
+        std::fprintf(stderr, "Loopback device did not answer\n");
+        g_failed = true;
+        return;
+    }
+    sync.handleConnectionEstablished();
+
+    QVector<Pins> diodes;
+    for (int i = 0; i < PinMatrix::kSize; ++i)
+    {
+        diodes.append(PinMatrix::pinsAt(i));
+    }
+
+    measure("DiodeSyncService::reset (225)",
+            kResets,
+            [&]()
+            {
+                for (size_t i = 0; i < kResets; ++i)
+                {
+                    sync.reset(diodes);
+                }
+                waitForDevice(model);
+            });
+    expectDeviceDiodes(device, static_cast<size_t>(diodes.size()));
+
+    measure("DiodeSyncService upsert/remove",
+            kUpdates,
+            [&]()
+            {
+                for (size_t i = 0; i < kUpdates; ++i)
+                {
+                    const Pins pins = PinMatrix::pinsAt(static_cast<int>(i % PinMatrix::kSize));
+                    if (i % 2 == 0)
+                    {
+                        sync.upsert(pins);
+                    }
+                    else
+                    {
+                        sync.remove(pins);
+                    }
+                }
+                sync.reset({});
+                waitForDevice(model);
+            });
+    expectDeviceDiodes(device, 0);
+
+    model.closePort();
+}
+
+// Only the calling thread is timed, the ring is flushed between batches so no record is dropped
+void benchLogger()
+{
+    constexpr size_t kBatches   = 200;
+    constexpr size_t kBatchSize = 1024;
+
+    std::FILE* sink = std::tmpfile();
+    Logger::instance().setOutput(sink, sink);
+    Logger::instance().flush();
+
+    double          seconds = 0.0;
+    AllocationCount total{0, 0};
+    for (size_t batch = 0; batch < kBatches; ++batch)
+    {
+        const AllocationCount before = allocationsNow();
+        const auto            start  = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < kBatchSize; ++i)
+        {
+            LOG_INFO << "App command " << i << " P1=" << 3 << " P2=" << 7 << " srtt=" << 1.25 << std::endl;
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const AllocationCount after = allocationsNow();
+        total.allocations += after.allocations - before.allocations;
+        total.bytes += after.bytes - before.bytes;
+
+        Logger::instance().flush();
+    }
+
+    Logger::instance().setLevel(LogLevel::Warning);
+    const auto filteredStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kBatchSize * kBatches; ++i)
+    {
+        LOG_INFO << "App command " << i << " P1=" << 3 << " P2=" << 7 << " srtt=" << 1.25 << std::endl;
+    }
+    const auto filtered = std::chrono::duration<double>(std::chrono::steady_clock::now() - filteredStart).count();
+    Logger::instance().setLevel(LogLevel::Info);
+
+    // the tmpfile is not closed, the writer thread may still flush it
+    Logger::instance().setOutput(stdout, stderr);
+
+    const double ops = static_cast<double>(kBatches * kBatchSize);
+    std::printf("%-30s %9zu ops %10.1f ns/op %9.3f allocs/op %11.1f bytes/op\n",
+                "LOG_INFO (5 fields)",
+                kBatches * kBatchSize,
+                seconds * 1e9 / ops,
+                total.allocations / ops,
+                total.bytes / ops);
+    std::printf("%-30s %9zu ops %10.1f ns/op\n", "LOG_INFO below level", kBatches * kBatchSize, filtered * 1e9 / ops);
+}
+
+void benchProjectIO()
+{
+    constexpr size_t kOps = 50;
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath("bench.kbk");
+
+    Project project;
+    project.background = QImage(1280, 720, QImage::Format_RGB32);
+    project.background.fill(Qt::darkGray);
+    for (int i = 0; i < 100; ++i)
+    {
+        const Pins pins = PinMatrix::pinsAt(i);
+        ItemDef    button(i * 10.0, i * 5.0, "#0000FF", false);
+        ItemDef    led(i * 10.0, i * 5.0 + 100.0, "#00FF00", true);
+        button.p1 = led.p1 = pins.pin1;
+        button.p2 = led.p2 = pins.pin2;
+        project.buttons.append(button);
+        project.leds.append(led);
+    }
+
+    measure("ProjectIO::save",
+            kOps,
+            [&]()
+            {
+                for (size_t i = 0; i < kOps; ++i)
+                {
+                    g_sink += ProjectIO::save(path, project);
+                }
+            });
+
+    measure("ProjectIO::load",
+            kOps,
+            [&]()
+            {
+                for (size_t i = 0; i < kOps; ++i)
+                {
+                    Project loaded;
+                    g_sink += ProjectIO::load(path, loaded);
+                }
+            });
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    benchProtocol();
+    benchFrameParser();
+    benchDiodeSync();
+    benchProjectIO();
+    benchLogger();
+
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "FrameParser.h"
+
+namespace
+{
+
+std::vector<uint8_t> buildStatusFrame(uint8_t pin, uint8_t ledsNum)
+{
+    std::vector<uint8_t> payload{pin, pin, ledsNum};
+    for (uint8_t i = 0; i < ledsNum; ++i)
+    {
+        payload.push_back(static_cast<uint8_t>(1 + i % 15));
+        payload.push_back(static_cast<uint8_t>(1 + (i / 15) % 15));
+    }
+
+    std::vector<uint8_t> frame{
+        PROTOCOL_SOF, static_cast<uint8_t>(payload.size() + 2), static_cast<uint8_t>(Command::StatusUpdate)};
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    frame.push_back(calc_checksum(frame.data(), frame.size()));
+    return frame;
+}
+
+// garbageRatio is the number of noise bytes injected per frame byte
+std::vector<uint8_t> buildStream(size_t frames, double garbageRatio, uint32_t seed)
+{
+    std::mt19937                    rng(seed);
+    std::uniform_int_distribution<> byteDist(0, 255);
+    std::uniform_int_distribution<> ledsDist(0, 8);
+
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; i < frames; ++i)
+    {
+        const auto frame   = buildStatusFrame(static_cast<uint8_t>(1 + i % 15), static_cast<uint8_t>(ledsDist(rng)));
+        const auto garbage = static_cast<size_t>(frame.size() * garbageRatio);
+        for (size_t g = 0; g < garbage; ++g)
+        {
+            stream.push_back(static_cast<uint8_t>(byteDist(rng)));
+        }
+        stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+    return stream;
+}
+
+// Mirrors the previous QByteArray based implementation: front erase per skipped byte and a copy per frame
+size_t parseLegacy(const std::vector<uint8_t>& stream, size_t chunkSize)
+{
+    std::vector<uint8_t> buffer;
+    size_t               frames = 0;
+
+    for (size_t pos = 0; pos < stream.size(); pos += chunkSize)
+    {
+        const size_t end = std::min(stream.size(), pos + chunkSize);
+        buffer.insert(buffer.end(), stream.begin() + pos, stream.begin() + end);
+
+        while (buffer.size() >= 3)
+        {
+            if (buffer[0] != PROTOCOL_SOF)
+            {
+                buffer.erase(buffer.begin());
+                continue;
+            }
+            const size_t len = buffer[1];
+            if (buffer.size() < len + 2)
+            {
+                break;
+            }
+            std::vector<uint8_t> frame(buffer.begin(), buffer.begin() + len + 2);
+            buffer.erase(buffer.begin(), buffer.begin() + len + 2);
+
+            if (calc_checksum(frame.data(), len + 1) == frame[len + 1])
+            {
+                ++frames;
+            }
+        }
+    }
+    return frames;
+}
+
+size_t parseRing(const std::vector<uint8_t>& stream, size_t chunkSize)
+{
+    FrameParser parser;
+    size_t      frames = 0;
+
+    size_t pos = 0;
+    while (pos < stream.size())
+    {
+        const size_t chunk = std::min(chunkSize, stream.size() - pos);
+        pos += parser.feed(stream.data() + pos, chunk);
+        parser.drain([&frames](std::span<const uint8_t>) { ++frames; });
+    }
+    return frames;
+}
+
+template <typename Parser>
+void run(const char* name, const std::vector<uint8_t>& stream, size_t chunkSize, Parser&& parse)
+{
+    const auto   start   = std::chrono::steady_clock::now();
+    const size_t frames  = parse(stream, chunkSize);
+    const auto   elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-28s %10zu frames %10.3f ms %12.0f frames/s %8.1f MB/s\n",
+                name,
+                frames,
+                elapsed * 1e3,
+                frames / elapsed,
+                stream.size() / elapsed / 1e6);
+}
+
+}
+
+int main()
+{
+    constexpr size_t kFrames    = 200000;
+    constexpr size_t kChunkSize = 64; // typical USB-serial read size
+
+    const auto clean = buildStream(kFrames, 0.0, 1);
+    const auto noisy = buildStream(kFrames, 4.0, 2);
+
+    std::printf("clean input: %zu bytes, garbage-heavy input: %zu bytes\n", clean.size(), noisy.size());
+
+    run("ring buffer / clean", clean, kChunkSize, parseRing);
+    run("ring buffer / garbage", noisy, kChunkSize, parseRing);
+    run("legacy / clean", clean, kChunkSize, parseLegacy);
+    run("legacy / garbage", noisy, kChunkSize, parseLegacy);
+
+    return 0;
+}
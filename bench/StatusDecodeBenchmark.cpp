@@ -0,0 +1,246 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "FrameParser.h"
+#include "SpscQueue.h"
+#include "StatusFrame.h"
+
+namespace
+{
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+struct AllocationCount
+{
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+AllocationCount allocationsNow()
+{
+    return {g_allocations.load(std::memory_order_relaxed), g_allocatedBytes.load(std::memory_order_relaxed)};
+}
+
+// Every replaced allocation function counts and goes through malloc, every deallocation function goes through
+// free. Kept out of line so GCC does not pair an inlined free() with operator new (-Wmismatched-new-delete).
+[[gnu::noinline]] void* countedAlloc(std::size_t size, std::size_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    size = size ? size : 1;
+
+    // aligned_alloc wants the size to be a multiple of the alignment
+    void* ptr = alignment > alignof(std::max_align_t)
+                    ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                    : std::malloc(size);
+    if (ptr)
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void countedFree(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAlloc(size, 0);
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAlloc(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    countedFree(ptr);
+}
+
+namespace
+{
+
+std::vector<uint8_t> buildStatusFrame(uint8_t pin, uint8_t ledsNum)
+{
+    std::vector<uint8_t> payload{pin, pin, ledsNum};
+    for (uint8_t i = 0; i < ledsNum; ++i)
+    {
+        payload.push_back(static_cast<uint8_t>(1 + i % 15));
+        payload.push_back(static_cast<uint8_t>(1 + (i / 15) % 15));
+    }
+
+    std::vector<uint8_t> frame{
+        PROTOCOL_SOF, static_cast<uint8_t>(payload.size() + 2), static_cast<uint8_t>(Command::StatusUpdate)};
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    frame.push_back(calc_checksum(frame.data(), frame.size()));
+    return frame;
+}
+
+std::vector<uint8_t> buildStream(size_t frames)
+{
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; i < frames; ++i)
+    {
+        // up to the largest LED count that still fits Packet::length
+        const auto frame = buildStatusFrame(static_cast<uint8_t>(1 + i % 15), static_cast<uint8_t>(i % 126));
+        stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+    return stream;
+}
+
+std::span<const uint8_t> statusPayload(std::span<const uint8_t> frame)
+{
+    return frame.subspan(offsetof(Packet, payload), frame.size() - offsetof(Packet, payload) - 1);
+}
+
+using EventQueue = SpscQueue<StatusFrame, 1024>;
+
+// Current path: frame -> inline StatusFrame -> queue hop to the consumer
+size_t decodeInline(const std::vector<uint8_t>& stream, size_t chunkSize, EventQueue& queue, FrameParser& parser)
+{
+    size_t      frames = 0;
+    StatusFrame consumed;
+
+    size_t pos = 0;
+    while (pos < stream.size())
+    {
+        const size_t chunk = std::min(chunkSize, stream.size() - pos);
+        pos += parser.feed(stream.data() + pos, chunk);
+        parser.drain(
+            [&](std::span<const uint8_t> frame)
+            {
+                StatusFrame status;
+                if (decodeStatusPayload(statusPayload(frame), status) && queue.tryPush(std::move(status)))
+                {
+                    queue.tryPop(consumed);
+                    frames += consumed.leds.size() > 0 || consumed.pins.pin1 != 0;
+                }
+            });
+    }
+    return frames;
+}
+
+// Previous path: a fresh heap vector per status frame
+size_t decodeVector(const std::vector<uint8_t>& stream, size_t chunkSize, FrameParser& parser)
+{
+    size_t frames = 0;
+
+    size_t pos = 0;
+    while (pos < stream.size())
+    {
+        const size_t chunk = std::min(chunkSize, stream.size() - pos);
+        pos += parser.feed(stream.data() + pos, chunk);
+        parser.drain(
+            [&](std::span<const uint8_t> frame)
+            {
+                const auto*       status = reinterpret_cast<const StatusPayload*>(statusPayload(frame).data());
+                std::vector<Pins> leds;
+                leds.reserve(status->leds_num);
+                for (int i = 0; i < status->leds_num; ++i)
+                {
+                    leds.push_back(status->leds[i]);
+                }
+                frames += !leds.empty() || status->pins.pin1 != 0;
+            });
+    }
+    return frames;
+}
+
+template <typename Decoder>
+void run(const char* name, size_t frameCount, Decoder&& decode)
+{
+    const AllocationCount before  = allocationsNow();
+    const auto            start   = std::chrono::steady_clock::now();
+    const size_t          frames  = decode();
+    const auto            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const AllocationCount after   = allocationsNow();
+
+    const double allocations = static_cast<double>(after.allocations - before.allocations);
+    const double bytes       = static_cast<double>(after.bytes - before.bytes);
+
+    std::printf("%-22s %8zu frames %9.3f ms %8.1f ns/frame %8.3f allocs/frame %10.1f bytes/frame\n",
+                name,
+                frames,
+                elapsed * 1e3,
+                elapsed * 1e9 / frameCount,
+                allocations / frameCount,
+                bytes / frameCount);
+}
+
+}
+
+int main()
+{
+    constexpr size_t kFrames    = 200000;
+    constexpr size_t kChunkSize = 64;
+
+    const auto stream = buildStream(kFrames);
+
+    // everything the steady state needs is set up before counting
+    auto queue  = std::make_unique<EventQueue>();
+    auto parser = std::make_unique<FrameParser>();
+
+    std::printf("status stream: %zu frames, %zu bytes\n", kFrames, stream.size());
+
+    run("inline / queue hop", kFrames, [&]() { return decodeInline(stream, kChunkSize, *queue, *parser); });
+    run("heap vector", kFrames, [&]() { return decodeVector(stream, kChunkSize, *parser); });
+
+    return 0;
+}
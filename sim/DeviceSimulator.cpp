@@ -0,0 +1,429 @@
+#include "DeviceSimulator.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+
+// command + pins + leds_num + leds + checksum must fit Packet::length
+constexpr size_t kMaxStatusLeds = (255 - 5) / sizeof(Pins);
+
+const char* modeName(DeviceSimulator::Mode mode)
+{
+    switch (mode)
+    {
+        case DeviceSimulator::Mode::Run:
+            return "RUN";
+        case DeviceSimulator::Mode::CheckKeyboard:
+            return "CHECK_KEYBOARD";
+        case DeviceSimulator::Mode::Configure:
+            return "CONFIGURE";
+        case DeviceSimulator::Mode::DiodeConfig:
+            return "DIODE_CONFIG";
+        case DeviceSimulator::Mode::DiodeConfigDel:
+            return "DIODE_CONFIG_DEL";
+    }
+    return "?";
+}
+
+bool inMatrix(Pins pins)
+{
+    return PinMatrix::indexOf(pins.pin1, pins.pin2) >= 0;
+}
+
+Pins pinsOf(std::span<const uint8_t> payload)
+{
+    return Pins{payload.size() >= 1 ? payload[0] : uint8_t{0}, payload.size() >= 2 ? payload[1] : uint8_t{0}};
+}
+
+} // namespace
+
+DeviceSimulator::DeviceSimulator(WriteFunction write, const SimulatorOptions& options)
+    : m_write(std::move(write)), m_options(options), m_rng(options.seed)
+{
+    m_leds.reserve(kMaxStatusLeds);
+    m_nextStatus = Clock::now() + statusPeriod();
+}
+
+void DeviceSimulator::setCapture(WireCaptureWriter* capture)
+{
+    m_capture      = capture;
+    m_captureStart = Clock::now();
+}
+
+void DeviceSimulator::receive(const uint8_t* data, size_t size)
+{
+    if (m_capture)
+    {
+        const auto ts = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_captureStart);
+        m_capture->write(static_cast<uint64_t>(ts.count()), WireDirection::Rx, data, size);
+    }
+
+    if (m_options.verbose)
+    {
+        std::fprintf(stderr, "[RX] %zu bytes\n", size);
+    }
+
+    // the parser drains complete frames and junk, so every pass makes room for more
+    while (size > 0)
+    {
+        const size_t fed = m_parser.feed(data, size);
+        m_parser.drain([this](std::span<const uint8_t> frame) { handleFrame(frame); });
+        data += fed;
+        size -= fed;
+    }
+}
+
+void DeviceSimulator::handleFrame(std::span<const uint8_t> frame)
+{
+    ++m_stats.framesReceived;
+
+    const uint8_t raw     = frame[offsetof(Packet, command)];
+    auto          payload = frame.subspan(offsetof(Packet, payload), frame.size() - offsetof(Packet, payload) - 1);
+
+    int seq = -1;
+    if (is_sequenced(raw))
+    {
+        if (payload.empty())
+        {
+            return;
+        }
+        seq     = payload[0];
+        payload = payload.subspan(1);
+    }
+
+    const Command command = command_from_byte(raw);
+    if (seq < 0 && command == Command::Echo)
+    {
+        // a new host session, its sequence numbers start over
+        m_seqHistory.fill(SeqRecord{});
+    }
+    else if (seq >= 0 && repeatAck(command, seq))
+    {
+        return;
+    }
+
+    handleCommand(command, seq, payload);
+}
+
+void DeviceSimulator::handleCommand(Command command, int seq, std::span<const uint8_t> payload)
+{
+    const Pins pins = pinsOf(payload);
+
+    switch (command)
+    {
+        case Command::Echo:
+        {
+            const EchoReplyPayload reply{PROTOCOL_VERSION, m_options.capabilities};
+            sendAck(command, seq, reinterpret_cast<const uint8_t*>(&reply), sizeof(reply));
+            return;
+        }
+        case Command::ModeDiodeClear:
+            m_diodes.reset();
+            sendAck(command, seq);
+            return;
+        case Command::DiodeDigest:
+            if (m_options.capabilities & PROTOCOL_CAP_DIODE_DIGEST)
+            {
+                const uint32_t digest = PinMatrix::digestOf(m_diodes);
+                const uint8_t  reply[sizeof(DiodeDigestPayload)]{static_cast<uint8_t>(m_diodes.count()),
+                                                                  static_cast<uint8_t>(digest),
+                                                                  static_cast<uint8_t>(digest >> 8),
+                                                                  static_cast<uint8_t>(digest >> 16),
+                                                                  static_cast<uint8_t>(digest >> 24)};
+                sendAck(command, seq, reply, sizeof(reply));
+                return;
+            }
+            break;
+        case Command::DiodePressed:
+        case Command::DiodeReleased:
+            if (m_options.verbose)
+            {
+                std::fprintf(stderr, "[DIODE] %s %d-%d\n", command == Command::DiodePressed ? "pressed" : "released",
+                             pins.pin1, pins.pin2);
+            }
+            return;
+        case Command::ModeRun:
+            setMode(Mode::Run);
+            return;
+        case Command::ModeCheckKeyboard:
+            setMode(Mode::CheckKeyboard);
+            return;
+        case Command::ModeConfigure:
+            setMode(Mode::Configure);
+            return;
+        case Command::ModeDiodeConfig:
+            if (inMatrix(pins))
+            {
+                m_diodes.set(PinMatrix::indexOf(pins.pin1, pins.pin2));
+            }
+            setMode(Mode::DiodeConfig);
+            sendAck(command, seq);
+            return;
+        case Command::ModeDiodeConfigDel:
+            if (inMatrix(pins))
+            {
+                m_diodes.reset(PinMatrix::indexOf(pins.pin1, pins.pin2));
+            }
+            setMode(Mode::DiodeConfigDel);
+            sendAck(command, seq);
+            return;
+        case Command::ModeDiodeConfigBatch:
+            if (m_options.capabilities & PROTOCOL_CAP_DIODE_BATCH)
+            {
+                const size_t count = payload.empty() ? 0 : std::min<size_t>(payload[0], (payload.size() - 1) / 2);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const Pins diode{payload[1 + 2 * i], payload[2 + 2 * i]};
+                    if (inMatrix(diode))
+                    {
+                        m_diodes.set(PinMatrix::indexOf(diode.pin1, diode.pin2));
+                    }
+                }
+                setMode(Mode::DiodeConfig);
+                sendAck(command, seq);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+
+    handleModeCommand(command, payload);
+}
+
+void DeviceSimulator::handleModeCommand(Command command, std::span<const uint8_t> payload)
+{
+    const Pins pins = pinsOf(payload);
+    const bool run  = m_mode == Mode::Run;
+    const bool test = m_mode == Mode::CheckKeyboard;
+
+    if ((run || test) && command == Command::ButtonPressed)
+    {
+        if (inMatrix(pins))
+        {
+            sendStatus(pins, std::span<const Pins>(&pins, 1));
+        }
+        else if (m_options.verbose)
+        {
+            std::fprintf(stderr, "[%s][WARN] press out of range %d-%d\n", modeName(m_mode), pins.pin1, pins.pin2);
+        }
+        return;
+    }
+
+    if (run && command == Command::ButtonReleased)
+    {
+        sendStatus(pins, {});
+        return;
+    }
+
+    if (test && command == Command::ButtonReleased)
+    {
+        return;
+    }
+
+    if (m_options.verbose)
+    {
+        std::fprintf(stderr, "[%s] ignore cmd=0x%02X\n", modeName(m_mode), static_cast<unsigned>(command));
+    }
+}
+
+void DeviceSimulator::tick(Clock::time_point now)
+{
+    if (m_mode == Mode::CheckKeyboard && now >= m_nextCheck)
+    {
+        const Pins pins{static_cast<uint8_t>(m_checkIndex), static_cast<uint8_t>(m_checkIndex)};
+        sendStatus(pins, {});
+
+        m_checkIndex = 1 + m_checkIndex % PinMatrix::kPinCount;
+        m_nextCheck  = now + std::chrono::milliseconds(m_options.checkIntervalMs);
+    }
+
+    if (m_options.statusRateHz <= 0.0 || now < m_nextStatus)
+    {
+        return;
+    }
+
+    // a late loop iteration does not produce a burst, the rate is an upper bound
+    m_nextStatus = std::max(m_nextStatus + statusPeriod(), now);
+    if (m_mode != Mode::Run)
+    {
+        return;
+    }
+
+    std::uniform_int_distribution<int> pinDist(1, PinMatrix::kPinCount);
+    const Pins pins{static_cast<uint8_t>(pinDist(m_rng)), static_cast<uint8_t>(pinDist(m_rng))};
+
+    m_leds.clear();
+    if (m_diodes.none())
+    {
+        m_leds.push_back(pins);
+    }
+    else
+    {
+        for (int i = 0; i < PinMatrix::kSize && m_leds.size() < kMaxStatusLeds; ++i)
+        {
+            if (m_diodes.test(i) && chance(0.5))
+            {
+                m_leds.push_back(PinMatrix::pinsAt(i));
+            }
+        }
+    }
+
+    sendStatus(pins, m_leds);
+}
+
+void DeviceSimulator::setMode(Mode mode)
+{
+    if (m_options.verbose)
+    {
+        std::fprintf(stderr, "[MODE] %s -> %s\n", modeName(m_mode), modeName(mode));
+    }
+
+    m_mode = mode;
+    if (mode == Mode::CheckKeyboard)
+    {
+        m_checkIndex = 1;
+        m_nextCheck  = Clock::now();
+    }
+}
+
+DeviceSimulator::Clock::time_point DeviceSimulator::nextDeadline() const
+{
+    // wake up now and then even when idle, so a stop request is noticed
+    auto deadline = Clock::now() + std::chrono::milliseconds(100);
+    if (m_mode == Mode::CheckKeyboard)
+    {
+        deadline = std::min(deadline, m_nextCheck);
+    }
+    if (m_options.statusRateHz > 0.0)
+    {
+        deadline = std::min(deadline, m_nextStatus);
+    }
+    return deadline;
+}
+
+DeviceSimulator::Clock::duration DeviceSimulator::statusPeriod()
+{
+    if (m_options.statusRateHz <= 0.0)
+    {
+        return Clock::duration::zero();
+    }
+
+    const auto period = std::chrono::duration<double>(1.0 / m_options.statusRateHz);
+    auto       result = std::chrono::duration_cast<Clock::duration>(period);
+    if (m_options.jitterUs > 0)
+    {
+        std::uniform_int_distribution<uint32_t> jitterDist(0, m_options.jitterUs);
+        result += std::chrono::microseconds(jitterDist(m_rng));
+    }
+    return result;
+}
+
+bool DeviceSimulator::repeatAck(Command command, int seq)
+{
+    for (const SeqRecord& record : m_seqHistory)
+    {
+        if (record.seq == seq && record.command == command)
+        {
+            ++m_stats.framesRepeated;
+            if (m_options.verbose)
+            {
+                std::fprintf(stderr, "[ACK] repeated cmd=0x%02X seq=%d\n", static_cast<unsigned>(command), seq);
+            }
+            transmitAck(command, seq, record.reply, record.replySize);
+            return true;
+        }
+    }
+    return false;
+}
+
+void DeviceSimulator::sendAck(Command command, int seq, const uint8_t* payload, size_t size)
+{
+    if (seq >= 0)
+    {
+        SeqRecord& record = m_seqHistory[m_seqHistoryNext];
+        m_seqHistoryNext  = (m_seqHistoryNext + 1) % m_seqHistory.size();
+        record.seq        = seq;
+        record.command    = command;
+        record.replySize  = static_cast<uint8_t>(std::min(size, sizeof(record.reply)));
+        std::copy_n(payload, record.replySize, record.reply);
+    }
+
+    transmitAck(command, seq, payload, size);
+}
+
+void DeviceSimulator::transmitAck(Command command, int seq, const uint8_t* payload, size_t size)
+{
+    if (chance(m_options.ackDropRate))
+    {
+        ++m_stats.acksDropped;
+        if (m_options.verbose)
+        {
+            std::fprintf(stderr, "[ACK] dropped cmd=0x%02X seq=%d\n", static_cast<unsigned>(command), seq);
+        }
+        return;
+    }
+
+    const std::span<const uint8_t> body(payload, size);
+
+    auto frame =
+        seq < 0 ? build_packet(command, body) : build_sequenced_packet(command, static_cast<uint8_t>(seq), body);
+    ++m_stats.acksSent;
+    sendFrame(frame);
+}
+
+void DeviceSimulator::sendStatus(Pins pins, std::span<const Pins> leds)
+{
+    const size_t ledsNum = std::min(leds.size(), kMaxStatusLeds);
+
+    uint8_t payload[sizeof(StatusPayload) + kMaxStatusLeds * sizeof(Pins)];
+    auto*   status     = reinterpret_cast<StatusPayload*>(payload);
+    status->pins       = pins;
+    status->leds_num   = static_cast<uint8_t>(ledsNum);
+    std::copy_n(leds.begin(), ledsNum, status->leds);
+
+    auto frame = build_packet(Command::StatusUpdate,
+                              std::span<const uint8_t>(payload, sizeof(StatusPayload) + ledsNum * sizeof(Pins)));
+    ++m_stats.statusSent;
+    sendFrame(frame);
+}
+
+void DeviceSimulator::sendFrame(std::vector<uint8_t>& frame)
+{
+    if (frame.empty())
+    {
+        return;
+    }
+
+    if (chance(m_options.corruptRate))
+    {
+        std::uniform_int_distribution<size_t> byteDist(0, frame.size() - 1);
+        std::uniform_int_distribution<int>    bitDist(0, 7);
+        frame[byteDist(m_rng)] ^= static_cast<uint8_t>(1u << bitDist(m_rng));
+        ++m_stats.framesCorrupted;
+    }
+
+    if (m_capture)
+    {
+        const auto ts = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_captureStart);
+        m_capture->write(static_cast<uint64_t>(ts.count()), WireDirection::Tx, frame.data(), frame.size());
+    }
+
+    // a full link buffer means the host is not reading, the tail is lost like on a real UART
+    const size_t sent = m_write(frame.data(), frame.size());
+    m_stats.bytesOverrun += frame.size() - std::min(sent, frame.size());
+    ++m_stats.framesSent;
+}
+
+bool DeviceSimulator::chance(double probability)
+{
+    if (probability <= 0.0)
+    {
+        return false;
+    }
+
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    return dist(m_rng) < probability;
+}
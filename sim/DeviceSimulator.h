@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "FrameParser.h"
+#include "PinMatrix.h"
+#include "WireCapture.h"
+
+struct SimulatorOptions
+{
+    double   statusRateHz{0.0};  // unsolicited status frames per second in Run mode, 0 only answers presses
+    uint32_t jitterUs{0};        // random delay added to every unsolicited status frame
+    double   corruptRate{0.0};   // probability that a sent frame gets one bit flipped
+    double   ackDropRate{0.0};   // probability that an ACK is not sent at all
+    uint32_t checkIntervalMs{2000};
+    uint8_t  capabilities{PROTOCOL_CAP_SEQUENCE | PROTOCOL_CAP_DIODE_BATCH | PROTOCOL_CAP_DIODE_DIGEST};
+    uint32_t seed{1};
+    bool     verbose{false};
+};
+
+struct SimulatorStats
+{
+    uint64_t framesReceived{0};
+    uint64_t framesSent{0};
+    uint64_t statusSent{0};
+    uint64_t acksSent{0};
+    uint64_t acksDropped{0};
+    uint64_t framesCorrupted{0};
+    uint64_t framesRepeated{0}; // sequenced frames acknowledged again without being applied
+    uint64_t bytesOverrun{0}; // not written because the host stopped reading
+};
+
+// Keyboard controller firmware model, states and replies follow test/states.py.
+// Not tied to a link: bytes from the host go into receive(), frames to the host leave through the
+// write function. sim/main.cpp serves it on a pty, LoopbackDevice in-process. Single-threaded.
+class DeviceSimulator
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Returns the number of bytes the link accepted, the rest is lost like on a full UART
+    using WriteFunction = std::function<size_t(const uint8_t* data, size_t size)>;
+
+    enum class Mode
+    {
+        Run,
+        CheckKeyboard,
+        Configure,
+        DiodeConfig,
+        DiodeConfigDel
+    };
+
+    DeviceSimulator(WriteFunction write, const SimulatorOptions& options);
+
+    // Records both directions from the device side, optional
+    void setCapture(WireCaptureWriter* capture);
+
+    // Bytes received from the host, any split
+    void receive(const uint8_t* data, size_t size);
+
+    // Sends what is due by now, call again at nextDeadline() at the latest
+    void              tick(Clock::time_point now);
+    Clock::time_point nextDeadline() const;
+
+    const SimulatorStats& stats() const { return m_stats; }
+    const FrameParser&    parser() const { return m_parser; }
+    const PinMatrix::Set& diodes() const { return m_diodes; }
+    Mode                  mode() const { return m_mode; }
+
+private:
+    void handleFrame(std::span<const uint8_t> frame);
+    void handleCommand(Command command, int seq, std::span<const uint8_t> payload);
+    void handleModeCommand(Command command, std::span<const uint8_t> payload);
+
+    void setMode(Mode mode);
+
+    Clock::duration statusPeriod();
+
+    bool repeatAck(Command command, int seq);
+    void sendAck(Command command, int seq, const uint8_t* payload = nullptr, size_t size = 0);
+    void transmitAck(Command command, int seq, const uint8_t* payload, size_t size);
+    void sendStatus(Pins pins, std::span<const Pins> leds);
+    void sendFrame(std::vector<uint8_t>& frame);
+
+    bool chance(double probability);
+
+    WriteFunction    m_write;
+    SimulatorOptions m_options;
+    SimulatorStats   m_stats;
+
+    FrameParser        m_parser;
+    WireCaptureWriter* m_capture{nullptr};
+    Clock::time_point  m_captureStart{Clock::now()};
+
+    // Replies of the last applied sequence numbers, see PROTOCOL_SEQ_FLAG
+    struct SeqRecord
+    {
+        int     seq{-1};
+        Command command{Command::None};
+        uint8_t replySize{0};
+        uint8_t reply[8]{};
+    };
+    static_assert(sizeof(SeqRecord::reply) >= sizeof(DiodeDigestPayload), "largest ACK payload");
+
+    std::array<SeqRecord, PROTOCOL_SEQ_HISTORY> m_seqHistory{};
+    size_t                                      m_seqHistoryNext{0};
+
+    Mode           m_mode{Mode::Run};
+    PinMatrix::Set m_diodes; // device diode table
+    int            m_checkIndex{1};
+
+    Clock::time_point m_nextCheck{};
+    Clock::time_point m_nextStatus{};
+
+    std::mt19937      m_rng;
+    std::vector<Pins> m_leds; // reused for every generated status frame
+};
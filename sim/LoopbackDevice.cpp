@@ -0,0 +1,57 @@
+#include "LoopbackDevice.h"
+
+#include <algorithm>
+
+LoopbackDevice::LoopbackDevice(const SimulatorOptions& options, QObject* parent)
+    : QObject(parent),
+      m_simulator(
+          [this](const uint8_t* data, size_t size)
+          {
+              // the device end never blocks, a closed host end swallows the bytes like a loose cable
+              const int64_t written = m_device->write(data, size);
+              return written > 0 ? static_cast<size_t>(written) : size_t{0};
+          },
+          options),
+      m_tickTimer(this)
+{
+    auto pair = LoopbackTransport::createPair();
+    m_device  = std::move(pair.first);
+    m_host    = std::move(pair.second);
+    m_device->open();
+
+    connect(m_device.get(), &ITransport::readyRead, this, &LoopbackDevice::handleReadyRead);
+
+    m_tickTimer.setSingleShot(true);
+    m_tickTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_tickTimer, &QTimer::timeout, this, &LoopbackDevice::tick);
+    scheduleTick();
+}
+
+std::unique_ptr<ITransport> LoopbackDevice::takeHostTransport()
+{
+    return std::move(m_host);
+}
+
+void LoopbackDevice::handleReadyRead()
+{
+    uint8_t chunk[512];
+    for (int64_t read = 0; (read = m_device->read(chunk, sizeof(chunk))) > 0;)
+    {
+        m_simulator.receive(chunk, static_cast<size_t>(read));
+    }
+    scheduleTick();
+}
+
+void LoopbackDevice::tick()
+{
+    m_simulator.tick(DeviceSimulator::Clock::now());
+    scheduleTick();
+}
+
+void LoopbackDevice::scheduleTick()
+{
+    // rounded up, a deadline less than 1 ms away must not turn into a busy 0 ms timer
+    const auto wait = m_simulator.nextDeadline() - DeviceSimulator::Clock::now();
+    const auto ms   = std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+    m_tickTimer.start(static_cast<int>(std::max<int64_t>(ms, 0)));
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <memory>
+
+#include "DeviceSimulator.h"
+#include "LoopbackTransport.h"
+
+// DeviceSimulator behind one end of a LoopbackTransport pair, served by the event loop of the
+// thread it was created on. Drives SerialPortModel against the firmware model without a tty.
+class LoopbackDevice : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoopbackDevice(const SimulatorOptions& options = {}, QObject* parent = nullptr);
+
+    // The host end, for SerialPortModel::adoptTransport(). Only one host end exists.
+    std::unique_ptr<ITransport> takeHostTransport();
+
+    const DeviceSimulator& simulator() const { return m_simulator; }
+
+private slots:
+    void handleReadyRead();
+    void tick();
+
+private:
+    void scheduleTick();
+
+    std::unique_ptr<LoopbackTransport> m_device;
+    std::unique_ptr<LoopbackTransport> m_host;
+    DeviceSimulator                    m_simulator;
+    QTimer                             m_tickTimer;
+};
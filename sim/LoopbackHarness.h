@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QObject>
+
+#include "KeyboardControllerProtocol.h"
+#include "LoopbackDevice.h"
+#include "SerialPortModel.h"
+
+// Helpers shared by the tests and the benchmarks that drive SerialPortModel against a LoopbackDevice
+
+// Runs the event loop until done() holds, the loopback device and the model's event channel live on it
+template <typename Predicate>
+bool spinUntil(Predicate&& done, int timeoutMs = 10000)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done())
+    {
+        if (timer.elapsed() > timeoutMs)
+        {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+// The device answers in order, once an Echo queued behind the sync is answered the sync has been applied
+inline bool waitForDevice(SerialPortModel& model)
+{
+    bool       echoed     = false;
+    const auto connection = QObject::connect(&model, &SerialPortModel::echoReceived, [&echoed]() { echoed = true; });
+    model.sendCommand(Command::Echo);
+    const bool answered = spinUntil([&echoed]() { return echoed; });
+    QObject::disconnect(connection);
+    return answered;
+}
+
+// Like a real connect, the first Echo reports the capabilities
+inline bool connectTo(LoopbackDevice& device, SerialPortModel& model)
+{
+    return model.adoptTransport(device.takeHostTransport(), 0) && waitForDevice(model);
+}
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+
+#include "DeviceSimulator.h"
+
+namespace
+{
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void handleSignal(int)
+{
+    g_stop = 1;
+}
+
+void printUsage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --link <path>          pty symlink the host opens, /tmp/ttyV1 by default\n"
+                 "  --status-rate <hz>     unsolicited status frames per second in RUN mode\n"
+                 "  --jitter <us>          random delay added to every unsolicited status frame\n"
+                 "  --corrupt-rate <p>     probability of a bit flip in a sent frame, 0..1\n"
+                 "  --ack-drop-rate <p>    probability of not sending an ACK, 0..1\n"
+                 "  --check-interval <ms>  period of the CHECK_KEYBOARD scan, 2000 by default\n"
+                 "  --legacy               no capabilities, like old firmware\n"
+                 "  --seed <n>             random seed\n"
+                 "  --capture <file>       record the device side to a pcapng file\n"
+                 "  -v, --verbose          log every frame to stderr\n",
+                 argv0);
+}
+
+// Opens a raw pty pair, the slave stays open so the master never sees a hangup between host sessions
+bool openPty(int& master, int& slave, std::string& slaveName)
+{
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        std::perror("posix_openpt");
+        return false;
+    }
+
+    slaveName = ptsname(master);
+    slave     = open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+    if (slave < 0)
+    {
+        std::perror("open pty slave");
+        return false;
+    }
+
+    termios tio{};
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    return true;
+}
+
+// Serves the host on the non-blocking pty master until a signal arrives
+void servePty(int fd, DeviceSimulator& simulator)
+{
+    while (!g_stop)
+    {
+        const auto now     = DeviceSimulator::Clock::now();
+        const auto wait    = std::max(simulator.nextDeadline() - now, DeviceSimulator::Clock::duration::zero());
+        const auto waitNs  = std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count();
+        const auto timeout = timespec{static_cast<time_t>(waitNs / 1000000000), static_cast<long>(waitNs % 1000000000)};
+
+        pollfd pfd{fd, POLLIN, 0};
+        const int ready = ppoll(&pfd, 1, &timeout, nullptr);
+        if (ready < 0 && errno != EINTR)
+        {
+            std::perror("ppoll");
+            return;
+        }
+
+        if (ready > 0 && (pfd.revents & POLLIN))
+        {
+            uint8_t chunk[512];
+            for (ssize_t read = 0; (read = ::read(fd, chunk, sizeof(chunk))) > 0;)
+            {
+                simulator.receive(chunk, static_cast<size_t>(read));
+            }
+        }
+
+        simulator.tick(DeviceSimulator::Clock::now());
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    SimulatorOptions options;
+    std::string      linkPath = "/tmp/ttyV1";
+    std::string      capturePath;
+
+    enum
+    {
+        OptLink = 1000,
+        OptStatusRate,
+        OptJitter,
+        OptCorruptRate,
+        OptAckDropRate,
+        OptCheckInterval,
+        OptLegacy,
+        OptSeed,
+        OptCapture
+    };
+
+    const option longOptions[] = {
+        {"link", required_argument, nullptr, OptLink},
+        {"status-rate", required_argument, nullptr, OptStatusRate},
+        {"jitter", required_argument, nullptr, OptJitter},
+        {"corrupt-rate", required_argument, nullptr, OptCorruptRate},
+        {"ack-drop-rate", required_argument, nullptr, OptAckDropRate},
+        {"check-interval", required_argument, nullptr, OptCheckInterval},
+        {"legacy", no_argument, nullptr, OptLegacy},
+        {"seed", required_argument, nullptr, OptSeed},
+        {"capture", required_argument, nullptr, OptCapture},
+        {"verbose", no_argument, nullptr, 'v'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "vh", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+            case OptLink:
+                linkPath = optarg;
+                break;
+            case OptStatusRate:
+                options.statusRateHz = std::atof(optarg);
+                break;
+            case OptJitter:
+                options.jitterUs = static_cast<uint32_t>(std::strtoul(optarg, nullptr, 10));
+                break;
+            case OptCorruptRate:
+                options.corruptRate = std::atof(optarg);
+                break;
+            case OptAckDropRate:
+                options.ackDropRate = std::atof(optarg);
+                break;
+            case OptCheckInterval:
+                options.checkIntervalMs = static_cast<uint32_t>(std::max(20ul, std::strtoul(optarg, nullptr, 10)));
+                break;
+            case OptLegacy:
+                options.capabilities = 0;
+                break;
+            case OptSeed:
+                options.seed = static_cast<uint32_t>(std::strtoul(optarg, nullptr, 10));
+                break;
+            case OptCapture:
+                capturePath = optarg;
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            default:
+                printUsage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    int         master = -1;
+    int         slave  = -1;
+    std::string slaveName;
+    if (!openPty(master, slave, slaveName))
+    {
+        return 1;
+    }
+
+    unlink(linkPath.c_str());
+    if (symlink(slaveName.c_str(), linkPath.c_str()) != 0)
+    {
+        std::fprintf(stderr, "Cannot link %s to %s: %s\n", linkPath.c_str(), slaveName.c_str(), std::strerror(errno));
+        return 1;
+    }
+
+    WireCaptureWriter capture;
+    if (!capturePath.empty() && !capture.open(capturePath))
+    {
+        std::fprintf(stderr, "Cannot create capture file %s\n", capturePath.c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    std::fprintf(stderr, "[INFO] Device on %s -> %s\n", linkPath.c_str(), slaveName.c_str());
+
+    const auto writePty = [master](const uint8_t* data, size_t size) -> size_t
+    {
+        const ssize_t written = ::write(master, data, size);
+        return written > 0 ? static_cast<size_t>(written) : 0;
+    };
+
+    DeviceSimulator simulator(writePty, options);
+    if (capture.isOpen())
+    {
+        simulator.setCapture(&capture);
+    }
+    servePty(master, simulator);
+
+    const auto& stats = simulator.stats();
+    std::fprintf(stderr,
+                 "[INFO] rx frames=%llu checksum errors=%llu, tx frames=%llu status=%llu acks=%llu, "
+                 "dropped acks=%llu repeated=%llu corrupted=%llu overrun bytes=%llu\n",
+                 static_cast<unsigned long long>(stats.framesReceived),
+                 static_cast<unsigned long long>(simulator.parser().checksumErrors()),
+                 static_cast<unsigned long long>(stats.framesSent),
+                 static_cast<unsigned long long>(stats.statusSent),
+                 static_cast<unsigned long long>(stats.acksSent),
+                 static_cast<unsigned long long>(stats.acksDropped),
+                 static_cast<unsigned long long>(stats.framesRepeated),
+                 static_cast<unsigned long long>(stats.framesCorrupted),
+                 static_cast<unsigned long long>(stats.bytesOverrun));
+
+    unlink(linkPath.c_str());
+    close(slave);
+    close(master);
+    return 0;
+}
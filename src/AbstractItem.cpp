@@ -89,18 +89,17 @@ void AbstractItem::setShowExtendedMenu(bool isShow)
 
 void AbstractItem::clearStatus()
 {
-    setActive(false);
-    updateAppearance();
+    setStatus(false);
 }
 
-void AbstractItem::onStatusUpdate(Pins pins)
+void AbstractItem::setStatus(bool active)
 {
-    if (getPin1() != pins.pin1 || getPin2() != pins.pin2)
+    if (isActive() == active)
     {
         return;
     }
 
-    setActive(true);
+    setActive(active);
     updateAppearance();
 }
 
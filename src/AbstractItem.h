@@ -38,7 +38,7 @@ public slots:
     void setClickable(bool isClickable);
     void clearStatus();
 
-    void onStatusUpdate(Pins pins);
+    void setStatus(bool active);
 
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
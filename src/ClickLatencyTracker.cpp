@@ -0,0 +1,150 @@
+#include "ClickLatencyTracker.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "MonotonicClock.h"
+
+ClickLatencyTracker::ClickLatencyTracker() : m_sessionStartUs(monotonicUs()) {}
+
+bool ClickLatencyTracker::isTracked(Command command)
+{
+    return command == Command::ButtonPressed || command == Command::DiodePressed;
+}
+
+void ClickLatencyTracker::recordPress(Command command, Pins pins, int64_t pressUs)
+{
+    const int index = PinMatrix::indexOf(pins.pin1, pins.pin2);
+    if (!isTracked(command) || index < 0)
+    {
+        return;
+    }
+
+    expire(pressUs);
+    if (m_pendingCount == kMaxPending)
+    {
+        dropFront();
+    }
+
+    PendingPress& press = m_pending[(m_pendingHead + m_pendingCount) % kMaxPending];
+    press               = PendingPress{pins, index, pressUs, {}};
+    ++m_pendingCount;
+    ++m_presses;
+}
+
+void ClickLatencyTracker::recordStatus(Stage stage, const LedList& leds, int64_t statusUs)
+{
+    const size_t stageIndex = static_cast<size_t>(stage);
+
+    PinMatrix::Set current;
+    for (const Pins& led : leds)
+    {
+        const int index = PinMatrix::indexOf(led.pin1, led.pin2);
+        if (index >= 0)
+        {
+            current.set(index);
+        }
+    }
+
+    // only LEDs that were off in the previous frame can answer a press
+    const PinMatrix::Set lit = current & ~m_lastLeds[stageIndex];
+    m_lastLeds[stageIndex]   = current;
+
+    if (lit.none())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_pendingCount; ++i)
+    {
+        PendingPress& press = m_pending[(m_pendingHead + i) % kMaxPending];
+        if (!press.matched[stageIndex] && lit.test(press.index) && statusUs >= press.pressUs)
+        {
+            press.matched[stageIndex] = true;
+            m_histograms[stageIndex].record(statusUs - press.pressUs);
+        }
+    }
+
+    // fully matched presses leave from the front, the rest waits for its timeout
+    while (m_pendingCount > 0 && m_pending[m_pendingHead].complete())
+    {
+        m_pendingHead = (m_pendingHead + 1) % kMaxPending;
+        --m_pendingCount;
+    }
+}
+
+void ClickLatencyTracker::reset()
+{
+    m_pendingHead  = 0;
+    m_pendingCount = 0;
+    for (auto& histogram : m_histograms)
+    {
+        histogram.reset();
+    }
+    m_lastLeds.fill(PinMatrix::Set{});
+    m_sessionStartUs = monotonicUs();
+    m_presses        = 0;
+    m_unmatched      = 0;
+}
+
+void ClickLatencyTracker::expire(int64_t nowUs)
+{
+    while (m_pendingCount > 0 && nowUs - m_pending[m_pendingHead].pressUs > kMatchTimeoutUs)
+    {
+        dropFront();
+    }
+}
+
+void ClickLatencyTracker::dropFront()
+{
+    const PendingPress& front = m_pending[m_pendingHead];
+    if (!front.matched[static_cast<size_t>(Stage::Displayed)])
+    {
+        ++m_unmatched;
+    }
+    m_pendingHead = (m_pendingHead + 1) % kMaxPending;
+    --m_pendingCount;
+}
+
+namespace
+{
+
+QJsonObject histogramToJson(const LatencyHistogram& histogram)
+{
+    const LatencySummary summary = histogram.summary();
+
+    QJsonArray buckets;
+    histogram.forEachBucket(
+        [&buckets](int64_t lowUs, int64_t highUs, uint64_t count)
+        {
+            buckets.append(
+                QJsonArray{static_cast<qint64>(lowUs), static_cast<qint64>(highUs), static_cast<qint64>(count)});
+        });
+
+    QJsonObject object;
+    object["count"]   = static_cast<qint64>(summary.count);
+    object["minUs"]   = static_cast<qint64>(summary.minUs);
+    object["meanUs"]  = histogram.mean();
+    object["p50Us"]   = static_cast<qint64>(summary.p50Us);
+    object["p90Us"]   = static_cast<qint64>(histogram.percentile(90.0));
+    object["p99Us"]   = static_cast<qint64>(summary.p99Us);
+    object["p999Us"]  = static_cast<qint64>(summary.p999Us);
+    object["maxUs"]   = static_cast<qint64>(summary.maxUs);
+    object["buckets"] = buckets; // [lowUs, highUs, count]
+    return object;
+}
+
+} // namespace
+
+QByteArray ClickLatencyTracker::toJson(const QString& portName) const
+{
+    QJsonObject object;
+    object["port"]             = portName;
+    object["sessionUs"]        = static_cast<qint64>(monotonicUs() - m_sessionStartUs);
+    object["presses"]          = static_cast<qint64>(m_presses);
+    object["unmatchedPresses"] = static_cast<qint64>(m_unmatched);
+    object["clickToDecoded"]   = histogramToJson(histogram(Stage::Decoded));
+    object["clickToDisplayed"] = histogramToJson(histogram(Stage::Displayed));
+    return QJsonDocument(object).toJson(QJsonDocument::Indented);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <array>
+#include <cstdint>
+
+#include "CommandDefinition.h"
+#include "LatencyHistogram.h"
+#include "PinMatrix.h"
+#include "StatusFrame.h"
+
+// Click to LED latency.
+//
+// Every ButtonPressed/DiodePressed is matched with the first status frame whose LED list gains
+// the pressed pins, once when the frame is decoded on the I/O thread and once when it reaches
+// MainWindow::updateStatus. Timestamps come from monotonicUs(). GUI thread only.
+class ClickLatencyTracker
+{
+public:
+    enum class Stage
+    {
+        Decoded,   // the status frame was parsed by the worker
+        Displayed, // the coalesced snapshot was handed to the view
+        Count
+    };
+
+    // Presses without a matching LED change after this long are counted as unmatched
+    static constexpr int64_t kMatchTimeoutUs = 2000000;
+
+    ClickLatencyTracker();
+
+    static bool isTracked(Command command);
+
+    void recordPress(Command command, Pins pins, int64_t pressUs);
+    void recordStatus(Stage stage, const LedList& leds, int64_t statusUs);
+
+    // Starts a new session, e.g. after a reconnect
+    void reset();
+
+    const LatencyHistogram& histogram(Stage stage) const { return m_histograms[static_cast<size_t>(stage)]; }
+
+    uint64_t presses() const { return m_presses; }
+    uint64_t unmatchedPresses() const { return m_unmatched; }
+
+    // Summary and buckets of both stages as an indented JSON document
+    QByteArray toJson(const QString& portName) const;
+
+private:
+    struct PendingPress
+    {
+        Pins    pins{0, 0};
+        int     index{-1}; // PinMatrix index
+        int64_t pressUs{0};
+        bool    matched[static_cast<size_t>(Stage::Count)]{};
+
+        bool complete() const { return matched[0] && matched[1]; }
+    };
+
+    static constexpr size_t kStageCount = static_cast<size_t>(Stage::Count);
+
+    // Presses older than this many clicks are given up even before the timeout
+    static constexpr size_t kMaxPending = 32;
+
+    void expire(int64_t nowUs);
+    void dropFront();
+
+    std::array<PendingPress, kMaxPending> m_pending{};
+
+    size_t m_pendingHead{0};
+    size_t m_pendingCount{0};
+
+    std::array<LatencyHistogram, kStageCount> m_histograms{};
+    std::array<PinMatrix::Set, kStageCount>   m_lastLeds{};
+
+    int64_t  m_sessionStartUs{0};
+    uint64_t m_presses{0};
+    uint64_t m_unmatched{0};
+};
@@ -8,15 +8,15 @@
 ComPortMenu::ComPortMenu(QMainWindow* window, QObject* parent) : QObject(parent), m_window(window)
 {
     Q_ASSERT(m_window);
-    auto* menu = new QMenu(tr("COM Порт"), m_window);
+    m_menu = new QMenu(tr("COM Порт"), m_window);
 
-    m_statusAction = menu->addAction(tr("Соединение: нет"));
-    menu->addSeparator();
+    m_statusAction = m_menu->addAction(tr("Соединение: нет"));
+    m_menu->addSeparator();
 
-    QAction* refreshAction = menu->addAction(tr("Поиск устройства"));
+    QAction* refreshAction = m_menu->addAction(tr("Поиск устройства"));
     connect(refreshAction, &QAction::triggered, this, &ComPortMenu::refreshRequested);
 
-    m_window->menuBar()->addMenu(menu);
+    m_window->menuBar()->addMenu(m_menu);
 }
 
 void ComPortMenu::setStatusText(const QString& text)
@@ -26,3 +26,8 @@ void ComPortMenu::setStatusText(const QString& text)
         m_statusAction->setText(text);
     }
 }
+
+void ComPortMenu::addPanelAction(QAction* action)
+{
+    m_menu->addAction(action);
+}
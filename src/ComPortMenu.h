@@ -5,6 +5,7 @@
 
 class QAction;
 class QMainWindow;
+class QMenu;
 
 class ComPortMenu : public QObject
 {
@@ -15,10 +16,14 @@ public:
 
     void setStatusText(const QString& text);
 
+    // e.g. the toggle action of the diagnostics panel
+    void addPanelAction(QAction* action);
+
 signals:
     void refreshRequested();
 
 private:
     QMainWindow* m_window{nullptr};
+    QMenu*       m_menu{nullptr};
     QAction*     m_statusAction{nullptr};
 };
@@ -2,7 +2,9 @@
 
 #include <QMenu>
 
+#include "MonotonicClock.h"
 #include "TextDefinitions.h"
+#include "Tracer.h"
 
 CustomScene::CustomScene(QObject* parent) : QGraphicsScene(parent) {}
 
@@ -21,6 +23,25 @@ void CustomScene::setModifiable(bool isMod)
     isModifiable = isMod;
 }
 
+void CustomScene::drawBackground(QPainter* painter, const QRectF& rect)
+{
+    if (Tracer::instance().isEnabled())
+    {
+        repaintStartUs = monotonicUs();
+    }
+    QGraphicsScene::drawBackground(painter, rect);
+}
+
+void CustomScene::drawForeground(QPainter* painter, const QRectF& rect)
+{
+    QGraphicsScene::drawForeground(painter, rect);
+    if (Tracer::instance().isEnabled() && repaintStartUs != 0)
+    {
+        Tracer::instance().complete(TraceTrack::Scene, "repaint", repaintStartUs, monotonicUs());
+        repaintStartUs = 0;
+    }
+}
+
 void CustomScene::contextMenuEvent(QGraphicsSceneContextMenuEvent* event)
 {
     QGraphicsScene::contextMenuEvent(event);
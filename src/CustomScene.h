@@ -28,7 +28,12 @@ public slots:
 protected:
     void contextMenuEvent(QGraphicsSceneContextMenuEvent* event) override;
 
+    // Bracket every repaint, the span goes to the trace when it is enabled
+    void drawBackground(QPainter* painter, const QRectF& rect) override;
+    void drawForeground(QPainter* painter, const QRectF& rect) override;
+
 private:
-    bool isModifiable{};
-    bool isPasteEnabled{false};
+    bool    isModifiable{};
+    bool    isPasteEnabled{false};
+    int64_t repaintStartUs{0};
 };
\ No newline at end of file
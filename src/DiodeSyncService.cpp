@@ -1,8 +1,23 @@
 #include "DiodeSyncService.h"
 
+#include "KeyboardControllerProtocol.h"
+#include "PinMatrix.h"
 #include "SerialPortModel.h"
+#include "Tracer.h"
+#include "logger.h"
 
-DiodeSyncService::DiodeSyncService(SerialPortModel* model, QObject* parent) : QObject(parent), m_model(model) {}
+DiodeSyncService::DiodeSyncService(SerialPortModel* model, QObject* parent) : QObject(parent), m_model(model)
+{
+    m_resyncTimer.setSingleShot(true);
+    m_resyncTimer.setInterval(kResyncDelayMs);
+    connect(&m_resyncTimer, &QTimer::timeout, this, &DiodeSyncService::sendFullState);
+
+    if (m_model)
+    {
+        connect(m_model, &SerialPortModel::commandFailed, this, &DiodeSyncService::handleCommandFailed);
+        connect(m_model, &SerialPortModel::diodeDigestReceived, this, &DiodeSyncService::handleDiodeDigest);
+    }
+}
 
 void DiodeSyncService::reset(const QVector<Pins>& diodes)
 {
@@ -40,6 +55,15 @@ void DiodeSyncService::handleConnectionEstablished()
 {
     m_connected        = true;
     m_fullSyncRequired = true;
+
+    // a device that kept its table through a short disconnect needs no resync, one round trip tells
+    if (m_model && m_model->supportsCapability(PROTOCOL_CAP_DIODE_DIGEST))
+    {
+        m_awaitingDigest = true;
+        sendCommand(Command::DiodeDigest);
+        return;
+    }
+
     sendFullState();
 }
 
@@ -47,6 +71,61 @@ void DiodeSyncService::handleConnectionLost()
 {
     m_connected        = false;
     m_fullSyncRequired = true;
+    m_awaitingDigest   = false;
+    m_resyncTimer.stop();
+}
+
+void DiodeSyncService::handleDiodeDigest(int count, quint32 digest)
+{
+    if (!m_connected || !m_awaitingDigest)
+    {
+        return;
+    }
+    m_awaitingDigest = false;
+
+    // edits made while the query was in flight are part of the comparison, a mismatch resends them
+    PinMatrix::Set diodes;
+    for (const Pins& pins : qAsConst(m_diodeStates))
+    {
+        const int slot = PinMatrix::indexOf(pins.pin1, pins.pin2);
+        if (slot >= 0)
+        {
+            diodes.set(slot);
+        }
+    }
+
+    const bool matches = static_cast<size_t>(count) == diodes.count() && digest == PinMatrix::digestOf(diodes);
+    Tracer::instance().instant(TraceTrack::DiodeSync, matches ? "digest match" : "digest mismatch", "diodes", count);
+    if (!matches)
+    {
+        LOG_INFO << "Device diode table differs (" << count << " diodes, host " << diodes.count()
+                 << "), running full sync" << std::endl;
+        sendFullState();
+        return;
+    }
+
+    LOG_INFO << "Device diode table matches, " << count << " diodes, full sync skipped" << std::endl;
+    m_fullSyncRequired = false;
+}
+
+void DiodeSyncService::handleCommandFailed(Command command, Pins pins)
+{
+    const bool isDiodeCommand = (command == Command::ModeDiodeConfig || command == Command::ModeDiodeConfigDel ||
+                                 command == Command::ModeDiodeClear || command == Command::ModeDiodeConfigBatch ||
+                                 command == Command::DiodeDigest);
+    if (!isDiodeCommand || !m_connected)
+    {
+        return;
+    }
+
+    LOG_WRN << "Diode command " << static_cast<int>(command) << " P1=" << static_cast<int>(pins.pin1)
+            << " P2=" << static_cast<int>(pins.pin2) << " failed, scheduling full resync" << std::endl;
+
+    m_fullSyncRequired = true;
+    if (!m_resyncTimer.isActive())
+    {
+        m_resyncTimer.start();
+    }
 }
 
 void DiodeSyncService::sendFullState()
@@ -56,10 +135,29 @@ void DiodeSyncService::sendFullState()
         return;
     }
 
+    m_resyncTimer.stop();
+    m_awaitingDigest = false;
+
+    TraceScope trace(TraceTrack::DiodeSync, "full sync");
+    trace.setArg("diodes", m_diodeStates.size());
+
     sendCommand(Command::ModeDiodeClear);
-    for (const Pins& pins : qAsConst(m_diodeStates))
+    if (m_model->supportsCapability(PROTOCOL_CAP_DIODE_BATCH))
     {
-        sendCommand(Command::ModeDiodeConfig, pins);
+        QVector<Pins> diodes;
+        diodes.reserve(m_diodeStates.size());
+        for (const Pins& pins : qAsConst(m_diodeStates))
+        {
+            diodes.append(pins);
+        }
+        m_model->sendDiodeConfigBatch(diodes);
+    }
+    else
+    {
+        for (const Pins& pins : qAsConst(m_diodeStates))
+        {
+            sendCommand(Command::ModeDiodeConfig, pins);
+        }
     }
 
     m_fullSyncRequired = false;
@@ -3,6 +3,7 @@
 #include <QHash>
 #include <QObject>
 #include <QString>
+#include <QTimer>
 #include <QVector>
 
 #include "CommandDefinition.h"
@@ -24,6 +25,10 @@ public slots:
     void handleConnectionEstablished();
     void handleConnectionLost();
 
+private slots:
+    void handleCommandFailed(Command command, Pins pins);
+    void handleDiodeDigest(int count, quint32 digest);
+
 private:
     void sendFullState();
     void sendCommand(Command command, Pins pins) const;
@@ -34,6 +39,14 @@ private:
     SerialPortModel*     m_model{nullptr};
     QHash<QString, Pins> m_diodeStates;
 
+    QTimer m_resyncTimer;
+
     bool m_connected{false};
     bool m_fullSyncRequired{false};
+
+    // Set from the DiodeDigest query on connect until its reply decides whether to resync
+    bool m_awaitingDigest{false};
+
+    // Several commands of one burst usually fail together, resync once for all of them
+    static constexpr int kResyncDelayMs = 50;
 };
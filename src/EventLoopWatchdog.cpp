@@ -0,0 +1,120 @@
+#include "EventLoopWatchdog.h"
+
+#include <QMetaObject>
+#include <algorithm>
+#include <chrono>
+
+#include "MonotonicClock.h"
+#include "logger.h"
+
+namespace
+{
+
+const char* handlerName(const char* handler)
+{
+    return handler ? handler : "unknown handler";
+}
+
+} // namespace
+
+std::atomic<const char*> EventLoopWatchdog::s_currentHandler{nullptr};
+
+EventLoopWatchdog::EventLoopWatchdog(int thresholdMs) : m_thresholdUs(int64_t{std::max(1, thresholdMs)} * 1000) {}
+
+EventLoopWatchdog::~EventLoopWatchdog()
+{
+    stop();
+}
+
+void EventLoopWatchdog::start()
+{
+    if (m_thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop        = false;
+        m_pingPending = false;
+    }
+    m_thread = std::thread(&EventLoopWatchdog::run, this);
+    LOG_INFO << "Event loop watchdog started, stall threshold " << m_thresholdUs / 1000 << " ms" << std::endl;
+}
+
+void EventLoopWatchdog::stop()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
+}
+
+bool EventLoopWatchdog::stalledSince(int64_t sinceUs) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stallStartUs != 0 || (m_stats.stalls > 0 && m_lastStallEndUs >= sinceUs);
+}
+
+EventLoopWatchdog::Stats EventLoopWatchdog::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void EventLoopWatchdog::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_wakeup.wait_for(lock, std::chrono::milliseconds(kPingIntervalMs), [this] { return m_stop; }))
+    {
+        const int64_t now = monotonicUs();
+        if (!m_pingPending)
+        {
+            m_pingPending = true;
+            m_pingSentUs  = now;
+            QMetaObject::invokeMethod(&m_pingTarget, [this] { onPing(); }, Qt::QueuedConnection);
+            continue;
+        }
+
+        // the ping is still queued, whatever the loop runs now is what blocks it
+        if (m_stallStartUs == 0 && now - m_pingSentUs >= m_thresholdUs)
+        {
+            m_stallStartUs = m_pingSentUs;
+            m_stallHandler = currentHandler();
+            LOG_WRN << "GUI event loop blocked in " << handlerName(m_stallHandler) << std::endl;
+        }
+    }
+}
+
+void EventLoopWatchdog::onPing()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const int64_t now     = monotonicUs();
+    const int64_t delayUs = now - m_pingSentUs;
+    m_pingPending         = false;
+    if (delayUs < m_thresholdUs)
+    {
+        return;
+    }
+
+    // a stall shorter than one ping interval past the threshold ends before the watchdog sees it
+    const char* handler = m_stallStartUs != 0 ? m_stallHandler : nullptr;
+    m_stallStartUs      = 0;
+    m_lastStallEndUs    = now;
+    ++m_stats.stalls;
+    if (delayUs > m_stats.worstStallUs)
+    {
+        m_stats.worstStallUs      = delayUs;
+        m_stats.worstStallHandler = handler;
+    }
+
+    LOG_WRN << "GUI event loop stalled for " << delayUs / 1000 << " ms in " << handlerName(handler) << std::endl;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QObject>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Watches the GUI event loop from a thread of its own.
+//
+// Every kPingIntervalMs the watchdog posts a ping to the thread it was created on and measures how long
+// the loop takes to run it. A ping that waits longer than the threshold is a stall: the watchdog logs
+// the handler that was running, counts it and remembers when it ended, so timers that fired late
+// because of it can be told apart from a device that stopped answering.
+class EventLoopWatchdog
+{
+public:
+    struct Stats
+    {
+        uint64_t    stalls{0};
+        int64_t     worstStallUs{0};
+        const char* worstStallHandler{nullptr}; // handler that was running during the worst stall
+    };
+
+    explicit EventLoopWatchdog(int thresholdMs = kDefaultThresholdMs);
+    ~EventLoopWatchdog();
+
+    EventLoopWatchdog(const EventLoopWatchdog&)            = delete;
+    EventLoopWatchdog& operator=(const EventLoopWatchdog&) = delete;
+
+    void start();
+    void stop();
+
+    // True while a stall is in progress or when one ended after sinceUs (monotonicUs() time)
+    bool stalledSince(int64_t sinceUs) const;
+
+    Stats stats() const;
+
+    // Name shown for stalls, set by HandlerScope on the GUI thread
+    static const char* currentHandler() { return s_currentHandler.load(std::memory_order_relaxed); }
+
+    // Marks the enclosing scope as the running handler, nests
+    class HandlerScope
+    {
+    public:
+        explicit HandlerScope(const char* name)
+            : m_previous(s_currentHandler.exchange(name, std::memory_order_relaxed))
+        {
+        }
+
+        ~HandlerScope() { s_currentHandler.store(m_previous, std::memory_order_relaxed); }
+
+        HandlerScope(const HandlerScope&)            = delete;
+        HandlerScope& operator=(const HandlerScope&) = delete;
+
+    private:
+        const char* m_previous;
+    };
+
+    static constexpr int kDefaultThresholdMs = 100;
+    static constexpr int kPingIntervalMs     = 25;
+
+private:
+    void run();
+    void onPing();
+
+    static std::atomic<const char*> s_currentHandler;
+
+    const int64_t m_thresholdUs;
+
+    // Receives the pings, lives on the watched thread
+    QObject m_pingTarget;
+
+    // Guards everything below, held by the watchdog only between two waits
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_wakeup;
+    bool                    m_stop{false};
+    bool                    m_pingPending{false};
+    int64_t                 m_pingSentUs{0};
+    int64_t                 m_stallStartUs{0}; // 0 unless a stall is in progress
+    int64_t                 m_lastStallEndUs{0};
+    const char*             m_stallHandler{nullptr};
+    Stats                   m_stats{};
+
+    std::thread m_thread;
+};
@@ -0,0 +1,34 @@
+#include "FrameParser.h"
+
+#include <algorithm>
+
+size_t FrameParser::feed(const uint8_t* data, size_t size)
+{
+    const size_t count = std::min(size, freeSpace());
+    size_t       done  = 0;
+
+    while (done < count)
+    {
+        const size_t offset = m_write % kCapacity;
+        const size_t chunk  = std::min(count - done, kCapacity - offset);
+
+        std::memcpy(m_storage.data() + offset, data + done, chunk);
+        std::memcpy(m_storage.data() + offset + kCapacity, data + done, chunk);
+
+        m_write += chunk;
+        done += chunk;
+    }
+
+    return count;
+}
+
+void FrameParser::clear()
+{
+    m_read  = 0;
+    m_write = 0;
+}
+
+void FrameParser::consume(size_t count)
+{
+    m_read += std::min(count, size());
+}
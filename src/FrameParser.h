@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "KeyboardControllerProtocol.h"
+
+// Incremental frame extractor over a fixed-capacity ring buffer.
+//
+// Every byte is stored twice (at i and i + kCapacity), so the unread region is
+// always contiguous in memory: SOF search is a single memchr() and complete
+// frames are handed out as spans into the buffer without copying.
+class FrameParser
+{
+public:
+    static constexpr size_t kCapacity = 1024;
+
+    // Smallest valid frame: SOF, length, command, checksum
+    static constexpr size_t kMinFrameSize = offsetof(Packet, payload) + sizeof(uint8_t);
+
+    // Appends up to freeSpace() bytes, returns the number of bytes accepted
+    size_t feed(const uint8_t* data, size_t size);
+
+    // Calls onFrame(std::span<const uint8_t>) for every complete frame with a valid checksum.
+    // The span is only valid until the handler returns.
+    template <typename Handler>
+    void drain(Handler&& onFrame);
+
+    void clear();
+
+    size_t size() const { return m_write - m_read; }
+    size_t freeSpace() const { return kCapacity - size(); }
+
+    uint64_t skippedBytes() const { return m_skippedBytes; }
+    uint64_t checksumErrors() const { return m_checksumErrors; }
+
+private:
+    const uint8_t* readPtr() const { return m_storage.data() + (m_read % kCapacity); }
+    void           consume(size_t count);
+
+    std::array<uint8_t, kCapacity * 2> m_storage{};
+
+    // Monotonic cursors, the difference is the number of unread bytes
+    size_t m_read{0};
+    size_t m_write{0};
+
+    uint64_t m_skippedBytes{0};
+    uint64_t m_checksumErrors{0};
+};
+
+template <typename Handler>
+void FrameParser::drain(Handler&& onFrame)
+{
+    while (size() >= kMinFrameSize)
+    {
+        const uint8_t* data  = readPtr();
+        const size_t   avail = size();
+
+        if (data[0] != PROTOCOL_SOF)
+        {
+            const void*  sof     = std::memchr(data, PROTOCOL_SOF, avail);
+            const size_t garbage = sof ? static_cast<size_t>(static_cast<const uint8_t*>(sof) - data) : avail;
+            m_skippedBytes += garbage;
+            consume(garbage);
+            continue;
+        }
+
+        const size_t frameSize = static_cast<size_t>(data[1]) + 2;
+        if (avail < frameSize) // wait for full packet
+        {
+            return;
+        }
+
+        const size_t len = frameSize - 2;
+        if (len < kMinFrameSize - 2 || calc_checksum(data, len + 1) != data[len + 1])
+        {
+            ++m_checksumErrors;
+            consume(frameSize);
+            continue;
+        }
+
+        onFrame(std::span<const uint8_t>(data, frameSize));
+        consume(frameSize);
+    }
+}
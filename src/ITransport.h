@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+
+// Byte stream to the device. SerialPortWorker only talks to this interface, so the link can be a
+// serial port, a socket, a recording or an in-process device model.
+// Implementations are created, used and destroyed on the thread of their owner.
+class ITransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    using QObject::QObject;
+    ~ITransport() override = default;
+
+    virtual bool open() = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+
+    // Non-blocking, returns the number of bytes copied or -1 on error
+    virtual int64_t read(uint8_t* data, size_t maxSize) = 0;
+    virtual int64_t write(const uint8_t* data, size_t size) = 0;
+
+    // Drops everything received but not read yet
+    virtual void clear() = 0;
+
+    // A passive transport only plays data back: writes go nowhere and nothing is acknowledged
+    virtual bool isPassive() const { return false; }
+
+    // For logs, e.g. the port name
+    virtual QString description() const = 0;
+    virtual QString errorString() const = 0;
+
+signals:
+    void readyRead();
+    void errorOccurred(const QString& description);
+};
@@ -1,9 +1,18 @@
 #include "KeyboardController.h"
 
+#include <QDateTime>
+#include <QDir>
+#include <QGuiApplication>
+#include <QScreen>
+#include <cmath>
+
 #include "DiodeSyncService.h"
+#include "LinkDiagnostics.h"
 #include "MainWindow.h"
+#include "MonotonicClock.h"
 #include "SerialPortConnectionManager.h"
 #include "SerialPortModel.h"
+#include "StatusCoalescer.h"
 #include "logger.h"
 
 namespace
@@ -24,46 +33,19 @@ const char* toString(WorkMode mode)
             return "Unknown";
     }
 }
-
-const char* toString(Command command)
-{
-    switch (command)
-    {
-        case Command::ModeRun:
-            return "ModeRun";
-        case Command::ModeCheckKeyboard:
-            return "ModeCheckKeyboard";
-        case Command::ModeConfigure:
-            return "ModeConfigure";
-        case Command::ModeDiodeConfig:
-            return "ModeDiodeConfig";
-        case Command::ModeDiodeConfigDel:
-            return "ModeDiodeConfigDel";
-        case Command::ModeDiodeClear:
-            return "ModeDiodeClear";
-        case Command::ButtonPressed:
-            return "ButtonPressed";
-        case Command::ButtonReleased:
-            return "ButtonReleased";
-        case Command::DiodePressed:
-            return "DiodePressed";
-        case Command::DiodeReleased:
-            return "DiodeReleased";
-        case Command::Echo:
-            return "Echo";
-        case Command::StatusUpdate:
-            return "StatusUpdate";
-        default:
-            return "Unknown";
-    }
-}
 } // namespace
 
-KeyboardController::KeyboardController(SerialPortModel* model, MainWindow* view, QObject* parent)
+KeyboardController::KeyboardController(SerialPortModel*                                 model,
+                                       MainWindow*                                      view,
+                                       const SerialPortConnectionManager::PortOverride& portOverride,
+                                       QObject*                                         parent)
     : QObject(parent), m_model(model), m_view(view)
 {
-    // Model -> Controller slots
-    connect(m_model, &SerialPortModel::statusReceived, this, &KeyboardController::onStatusReceived);
+    // Model -> Controller slots, status frames are paced to the display refresh rate
+    m_statusCoalescer = new StatusCoalescer(displayFrameIntervalMs(), this);
+    connect(m_model, &SerialPortModel::statusReceived, this, &KeyboardController::onStatusDecoded);
+    connect(m_model, &SerialPortModel::statusReceived, m_statusCoalescer, &StatusCoalescer::push);
+    connect(m_statusCoalescer, &StatusCoalescer::statusReady, this, &KeyboardController::onStatusReceived);
     connect(m_model, &SerialPortModel::receivedCommand, this, &KeyboardController::handleHwCmd);
 
     // View -> Controller
@@ -77,6 +59,9 @@ KeyboardController::KeyboardController(SerialPortModel* model, MainWindow* view,
     connect(m_view, &MainWindow::diodeRemoved, m_diodeSync, &DiodeSyncService::remove);
 
     m_connectManager = new SerialPortConnectionManager(m_model, this);
+    m_connectManager->setPortOverride(portOverride);
+    m_connectManager->setEventLoopWatchdog(&m_loopWatchdog);
+    m_loopWatchdog.start();
 
     connect(m_connectManager,
             &SerialPortConnectionManager::connected,
@@ -98,25 +83,68 @@ KeyboardController::KeyboardController(SerialPortModel* model, MainWindow* view,
             this,
             &KeyboardController::handleRefreshComPortList,
             Qt::QueuedConnection);
+
+    m_uptime.start();
+    m_diagnosticsTimer.setInterval(kDiagnosticsRefreshMs);
+    connect(&m_diagnosticsTimer, &QTimer::timeout, this, &KeyboardController::refreshDiagnostics);
+    m_diagnosticsTimer.start();
+}
+
+KeyboardController::~KeyboardController()
+{
+    finishLatencySession();
 }
 
-void KeyboardController::onStatusReceived(Pins pins, const QVector<Pins>& leds)
+bool KeyboardController::startMetricsDump(const QString& path, int intervalMs)
 {
+    m_metricsDump.close();
+    m_metricsDump.setFileName(path);
+    if (!m_metricsDump.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        LOG_ERR << "Cannot open metrics dump " << path.toStdString() << std::endl;
+        return false;
+    }
+
+    m_metricsIntervalMs = std::max(kDiagnosticsRefreshMs, intervalMs);
+    m_sinceMetricsDump.invalidate();
+    LOG_INFO << "Writing link metrics to " << path.toStdString() << " every " << m_metricsIntervalMs << " ms"
+             << std::endl;
+    return true;
+}
+
+void KeyboardController::setLatencyExportDir(const QString& dir)
+{
+    m_latencyExportDir = dir;
+}
+
+void KeyboardController::onStatusDecoded(Pins /*pins*/, const LedList& leds, qint64 receivedUs)
+{
+    m_clickLatency.recordStatus(ClickLatencyTracker::Stage::Decoded, leds, receivedUs);
+}
+
+void KeyboardController::onStatusReceived(Pins pins, const LedList& leds)
+{
+    EventLoopWatchdog::HandlerScope handler("status update");
+    m_clickLatency.recordStatus(ClickLatencyTracker::Stage::Displayed, leds, monotonicUs());
     m_view->updateStatus(pins, leds);
 }
 
 void KeyboardController::handleAppCommands(Command command, Pins pins)
 {
-    LOG_INFO << "App command " << toString(command) << " P1=" << static_cast<int>(pins.pin1)
+    // stamped before anything else, the click handler emitted this synchronously
+    m_clickLatency.recordPress(command, pins, monotonicUs());
+    EventLoopWatchdog::HandlerScope handler("app command");
+
+    LOG_INFO << "App command " << command_name(command) << " P1=" << static_cast<int>(pins.pin1)
              << " P2=" << static_cast<int>(pins.pin2) << std::endl;
     m_model->sendCommand(command, pins);
 }
 
 void KeyboardController::handleHwCmd(Command command)
 {
-    LOG_INFO << "Hardware command received: " << toString(command) << std::endl;
+    LOG_INFO << "Hardware command received: " << command_name(command) << std::endl;
     const bool isConfigCommand = (command == Command::ModeDiodeConfig || command == Command::ModeDiodeConfigDel ||
-                                  command == Command::ModeDiodeClear);
+                                  command == Command::ModeDiodeClear || command == Command::ModeDiodeConfigBatch);
 
     if (isConfigCommand)
     {
@@ -126,6 +154,7 @@ void KeyboardController::handleHwCmd(Command command)
 
 void KeyboardController::handleWorkModeChanged(WorkMode mode)
 {
+    EventLoopWatchdog::HandlerScope handler("work mode change");
     LOG_INFO << "Switching to work mode " << toString(mode) << std::endl;
     m_currentMode = mode;
 
@@ -158,6 +187,10 @@ void KeyboardController::handleComPortSelected(const QString& portName)
 
 void KeyboardController::handleConnectionEstablished(const QString& port)
 {
+    // presses made while disconnected never had a chance to match
+    m_clickLatency.reset();
+    m_sessionPortName = port;
+
     if (m_diodeSync)
     {
         m_diodeSync->handleConnectionEstablished();
@@ -171,15 +204,94 @@ void KeyboardController::handleConnectionLost()
     {
         m_diodeSync->handleConnectionLost();
     }
+
+    LOG_INFO << "Status frames received=" << m_statusCoalescer->framesReceived()
+             << " shown=" << m_statusCoalescer->framesDelivered() << " merged=" << m_statusCoalescer->framesMerged()
+             << " dropped=" << m_statusCoalescer->framesDropped()
+             << " latched pulses=" << m_statusCoalescer->pulsesLatched() << std::endl;
+    m_statusCoalescer->reset();
+    finishLatencySession();
     m_view->updateComPort(QString("Не подключено"));
     m_view->showWarning(tr("Ошибка соединения"), tr("Нет соединения с устройством,\nПопробуйте переподключить USB"));
 }
 
+void KeyboardController::finishLatencySession()
+{
+    if (m_clickLatency.presses() == 0)
+    {
+        return;
+    }
+
+    const LatencySummary displayed = m_clickLatency.histogram(ClickLatencyTracker::Stage::Displayed).summary();
+    const LatencySummary decoded   = m_clickLatency.histogram(ClickLatencyTracker::Stage::Decoded).summary();
+    LOG_INFO << "Click to LED latency, " << m_clickLatency.presses() << " presses, "
+             << m_clickLatency.unmatchedPresses() << " unmatched: decoded p50=" << decoded.p50Us
+             << " p99=" << decoded.p99Us << " p999=" << decoded.p999Us << " us, displayed p50=" << displayed.p50Us
+             << " p99=" << displayed.p99Us << " p999=" << displayed.p999Us << " max=" << displayed.maxUs << " us"
+             << std::endl;
+
+    if (!m_latencyExportDir.isEmpty())
+    {
+        const QString stamp = QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss");
+        QFile         file(QDir(m_latencyExportDir).filePath(QString("click-latency-%1.json").arg(stamp)));
+        const bool    written = file.open(QIODevice::WriteOnly | QIODevice::Truncate) &&
+                                file.write(m_clickLatency.toJson(m_sessionPortName)) > 0;
+        if (written)
+        {
+            LOG_INFO << "Click latency written to " << file.fileName().toStdString() << std::endl;
+        }
+        else
+        {
+            LOG_ERR << "Cannot write click latency to " << file.fileName().toStdString() << std::endl;
+        }
+    }
+
+    m_clickLatency.reset();
+}
+
+int KeyboardController::displayFrameIntervalMs()
+{
+    const QScreen* screen      = QGuiApplication::primaryScreen();
+    const qreal    refreshRate = screen ? screen->refreshRate() : 0.0;
+    if (refreshRate < 1.0)
+    {
+        return kDefaultFrameIntervalMs;
+    }
+
+    return std::max(1, static_cast<int>(std::floor(1000.0 / refreshRate)));
+}
+
 void KeyboardController::handleConnectionError(const QString& err)
 {
     m_view->updateComPort(QString("Ошибка: %1").arg(err));
 }
 
+void KeyboardController::refreshDiagnostics()
+{
+    const bool dumpDue = m_metricsDump.isOpen() &&
+                         (!m_sinceMetricsDump.isValid() || m_sinceMetricsDump.elapsed() >= m_metricsIntervalMs);
+    if (!dumpDue && !m_view->isDiagnosticsVisible())
+    {
+        return;
+    }
+
+    EventLoopWatchdog::HandlerScope handler("diagnostics refresh");
+
+    LinkDiagnostics diagnostics  = m_connectManager->diagnostics();
+    diagnostics.clickToDecoded   = m_clickLatency.histogram(ClickLatencyTracker::Stage::Decoded).summary();
+    diagnostics.clickToDisplayed = m_clickLatency.histogram(ClickLatencyTracker::Stage::Displayed).summary();
+    diagnostics.unmatchedPresses = m_clickLatency.unmatchedPresses();
+    m_view->updateDiagnostics(diagnostics);
+
+    if (dumpDue)
+    {
+        m_sinceMetricsDump.start();
+        m_metricsDump.write(diagnostics.toJson(m_uptime.elapsed()));
+        m_metricsDump.write("\n");
+        m_metricsDump.flush();
+    }
+}
+
 void KeyboardController::handleRefreshComPortList()
 {
     m_view->updateComPort(QString("Поиск..."));
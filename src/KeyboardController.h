@@ -1,26 +1,43 @@
 #pragma once
 
+#include <QElapsedTimer>
+#include <QFile>
 #include <QObject>
 #include <QString>
-#include <QVector>
+#include <QTimer>
 
+#include "ClickLatencyTracker.h"
+#include "EventLoopWatchdog.h"
 #include "KeyboardControllerProtocol.h"
 #include "SerialPortConnectionManager.h"
+#include "StatusFrame.h"
 #include "WorkMode.h"
 
 class MainWindow;
 
 class SerialPortModel;
 class DiodeSyncService;
+class StatusCoalescer;
 
 class KeyboardController : public QObject
 {
     Q_OBJECT
 public:
-    KeyboardController(SerialPortModel* model, MainWindow* view, QObject* parent = nullptr);
+    KeyboardController(SerialPortModel*                                 model,
+                       MainWindow*                                      view,
+                       const SerialPortConnectionManager::PortOverride& portOverride = {},
+                       QObject*                                         parent = nullptr);
+    ~KeyboardController();
+
+    // Appends one JSON line of link diagnostics to path every intervalMs
+    bool startMetricsDump(const QString& path, int intervalMs);
+
+    // Writes the click to LED latency histograms of every session to a file in dir
+    void setLatencyExportDir(const QString& dir);
 
 private slots:
-    void onStatusReceived(Pins pins, const QVector<Pins>& leds);
+    void onStatusDecoded(Pins pins, const LedList& leds, qint64 receivedUs);
+    void onStatusReceived(Pins pins, const LedList& leds);
     void handleHwCmd(Command command);
 
     void handleAppCommands(Command command, Pins pins);
@@ -30,12 +47,34 @@ private slots:
     void handleConnectionLost();
     void handleConnectionError(const QString& err);
     void handleRefreshComPortList();
+    void refreshDiagnostics();
 
 private:
+    static int displayFrameIntervalMs();
+
+    void finishLatencySession();
+
     SerialPortModel*             m_model{nullptr};
     SerialPortConnectionManager* m_connectManager{nullptr};
     MainWindow*                  m_view{nullptr};
     DiodeSyncService*            m_diodeSync{nullptr};
+    StatusCoalescer*             m_statusCoalescer{nullptr};
 
     WorkMode m_currentMode{WorkMode::Modify};
+
+    // Lets the connection manager tell GUI stalls from a silent device
+    EventLoopWatchdog m_loopWatchdog;
+
+    ClickLatencyTracker m_clickLatency;
+    QString             m_latencyExportDir;
+    QString             m_sessionPortName;
+
+    QTimer        m_diagnosticsTimer;
+    QFile         m_metricsDump;
+    QElapsedTimer m_sinceMetricsDump;
+    QElapsedTimer m_uptime;
+    int           m_metricsIntervalMs{0};
+
+    static constexpr int kDefaultFrameIntervalMs = 16; // 60 Hz
+    static constexpr int kDiagnosticsRefreshMs   = 500;
 };
@@ -0,0 +1,106 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace
+{
+
+constexpr int64_t kLinearLimit = int64_t{1} << LatencyHistogram::kSubBucketBits;
+constexpr int64_t kHalfCount   = kLinearLimit / 2;
+constexpr int64_t kMaxValue    = (int64_t{1} << LatencyHistogram::kMaxValueBits) - 1;
+
+} // namespace
+
+void LatencyHistogram::record(int64_t valueUs)
+{
+    valueUs = std::max<int64_t>(0, valueUs);
+
+    m_min = m_count == 0 ? valueUs : std::min(m_min, valueUs);
+    m_max = std::max(m_max, valueUs);
+    m_sum += valueUs;
+    ++m_count;
+    ++m_counts[indexOf(valueUs)];
+}
+
+void LatencyHistogram::reset()
+{
+    m_counts.fill(0);
+    m_count = 0;
+    m_min   = 0;
+    m_max   = 0;
+    m_sum   = 0;
+}
+
+int64_t LatencyHistogram::percentile(double percent) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    const double   clamped = std::clamp(percent, 0.0, 100.0);
+    const uint64_t target  = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * m_count)));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i)
+    {
+        seen += m_counts[i];
+        if (seen >= target)
+        {
+            return std::clamp(highestValueAt(i), m_min, m_max);
+        }
+    }
+    return m_max;
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+    LatencySummary summary;
+    summary.count  = m_count;
+    summary.minUs  = min();
+    summary.p50Us  = percentile(50.0);
+    summary.p99Us  = percentile(99.0);
+    summary.p999Us = percentile(99.9);
+    summary.maxUs  = m_max;
+    return summary;
+}
+
+size_t LatencyHistogram::indexOf(int64_t valueUs)
+{
+    const uint64_t value = static_cast<uint64_t>(std::clamp<int64_t>(valueUs, 0, kMaxValue));
+    if (value < static_cast<uint64_t>(kLinearLimit))
+    {
+        return static_cast<size_t>(value);
+    }
+
+    // keep the top kSubBucketBits - 1 bits below the leading one
+    const int      shift = std::bit_width(value) - kSubBucketBits;
+    const uint64_t sub   = value >> shift;
+    return static_cast<size_t>(kLinearLimit + (shift - 1) * kHalfCount + (static_cast<int64_t>(sub) - kHalfCount));
+}
+
+int64_t LatencyHistogram::lowestValueAt(size_t index)
+{
+    if (index < static_cast<size_t>(kLinearLimit))
+    {
+        return static_cast<int64_t>(index);
+    }
+
+    const int64_t offset = static_cast<int64_t>(index) - kLinearLimit;
+    const int     shift  = static_cast<int>(offset / kHalfCount) + 1;
+    return (offset % kHalfCount + kHalfCount) << shift;
+}
+
+int64_t LatencyHistogram::highestValueAt(size_t index)
+{
+    if (index < static_cast<size_t>(kLinearLimit))
+    {
+        return static_cast<int64_t>(index);
+    }
+
+    const int64_t offset = static_cast<int64_t>(index) - kLinearLimit;
+    const int     shift  = static_cast<int>(offset / kHalfCount) + 1;
+    return ((offset % kHalfCount + kHalfCount + 1) << shift) - 1;
+}
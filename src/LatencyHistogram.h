@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct LatencySummary
+{
+    uint64_t count{0};
+    int64_t  minUs{0};
+    int64_t  p50Us{0};
+    int64_t  p99Us{0};
+    int64_t  p999Us{0};
+    int64_t  maxUs{0};
+};
+
+// HDR style log-linear histogram of microsecond latencies.
+//
+// Values below 128 us are exact, above that every power of two is split into 64 buckets,
+// so any recorded value is known within 1/64 of itself. Recording is one index computation
+// and an increment, memory is fixed (about 14 KiB) no matter how many samples are added.
+class LatencyHistogram
+{
+public:
+    static constexpr int    kSubBucketBits = 7;
+    static constexpr int    kMaxValueBits  = 32; // ~71 minutes, longer values land in the last bucket
+    static constexpr size_t kBucketCount =
+        (size_t{1} << kSubBucketBits) + (kMaxValueBits - kSubBucketBits) * (size_t{1} << (kSubBucketBits - 1));
+
+    void record(int64_t valueUs);
+    void reset();
+
+    uint64_t count() const { return m_count; }
+    int64_t  min() const { return m_count ? m_min : 0; }
+    int64_t  max() const { return m_max; }
+    double   mean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+
+    // Upper bound of the bucket holding the given percentile (0..100], clamped to the recorded range
+    int64_t percentile(double percent) const;
+
+    LatencySummary summary() const;
+
+    // Calls onBucket(lowUs, highUs, count) for every non-empty bucket in ascending order
+    template <typename Handler>
+    void forEachBucket(Handler&& onBucket) const;
+
+    static size_t  indexOf(int64_t valueUs);
+    static int64_t lowestValueAt(size_t index);
+    static int64_t highestValueAt(size_t index);
+
+private:
+    std::array<uint64_t, kBucketCount> m_counts{};
+
+    uint64_t m_count{0};
+    int64_t  m_min{0};
+    int64_t  m_max{0};
+    int64_t  m_sum{0};
+};
+
+template <typename Handler>
+void LatencyHistogram::forEachBucket(Handler&& onBucket) const
+{
+    for (size_t i = 0; i < kBucketCount; ++i)
+    {
+        if (m_counts[i] != 0)
+        {
+            onBucket(lowestValueAt(i), highestValueAt(i), m_counts[i]);
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#include "LinkDiagnostics.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <cmath>
+
+void HeartbeatStats::addSample(double rttMs)
+{
+    minRttMs  = answered == 0 ? rttMs : std::min(minRttMs, rttMs);
+    maxRttMs  = std::max(maxRttMs, rttMs);
+    lastRttMs = rttMs;
+    totalRttMs += rttMs;
+    ++answered;
+
+    int bucket = 0;
+    while (bucket < kBuckets - 1 && rttMs > bucketUpperBoundMs(bucket))
+    {
+        ++bucket;
+    }
+    ++rttHistogram[bucket];
+}
+
+double HeartbeatStats::meanRttMs() const
+{
+    return answered == 0 ? 0.0 : totalRttMs / answered;
+}
+
+double HeartbeatStats::bucketUpperBoundMs(int bucket)
+{
+    return bucket >= kBuckets - 1 ? INFINITY : std::ldexp(1.0, bucket);
+}
+
+namespace
+{
+
+// quint64 does not fit a JSON double past 2^53, no counter gets there in practice
+QJsonValue counter(quint64 value)
+{
+    return static_cast<qint64>(value);
+}
+
+QJsonObject laneToJson(const SerialPortModel::LaneStats& lane)
+{
+    QJsonObject object;
+    object["depth"]       = lane.depth;
+    object["maxDepth"]    = lane.maxDepth;
+    object["sent"]        = counter(lane.sent);
+    object["maxWaitUs"]   = lane.maxWaitUs;
+    object["totalWaitUs"] = lane.totalWaitUs;
+    return object;
+}
+
+QJsonObject latencyToJson(const LatencySummary& latency)
+{
+    QJsonObject object;
+    object["count"]  = counter(latency.count);
+    object["minUs"]  = static_cast<qint64>(latency.minUs);
+    object["p50Us"]  = static_cast<qint64>(latency.p50Us);
+    object["p99Us"]  = static_cast<qint64>(latency.p99Us);
+    object["p999Us"] = static_cast<qint64>(latency.p999Us);
+    object["maxUs"]  = static_cast<qint64>(latency.maxUs);
+    return object;
+}
+
+} // namespace
+
+QByteArray LinkDiagnostics::toJson(qint64 timestampMs) const
+{
+    QJsonObject linkObject;
+    linkObject["framesRx"]          = counter(link.framesRx);
+    linkObject["framesTx"]          = counter(link.framesTx);
+    linkObject["bytesRx"]           = counter(link.bytesRx);
+    linkObject["bytesTx"]           = counter(link.bytesTx);
+    linkObject["checksumErrors"]    = counter(link.checksumErrors);
+    linkObject["resyncBytes"]       = counter(link.resyncBytes);
+    linkObject["ackTimeouts"]       = counter(link.ackTimeouts);
+    linkObject["retries"]           = counter(link.retries);
+    linkObject["commandsFailed"]    = counter(link.commandsFailed);
+    linkObject["queueHighWater"]    = link.queueHighWater;
+    linkObject["inFlightHighWater"] = link.inFlightHighWater;
+    linkObject["coalescedFrames"]   = counter(coalescedFrames);
+
+    QJsonObject rttObject;
+    rttObject["smoothedMs"]     = smoothedRttMs;
+    rttObject["varianceMs"]     = rttVarianceMs;
+    rttObject["ackTimeoutMs"]   = ackTimeoutMs;
+    rttObject["commandDelayMs"] = commandDelayMs;
+
+    QJsonArray histogram;
+    for (quint64 count : heartbeat.rttHistogram)
+    {
+        histogram.append(counter(count));
+    }
+
+    QJsonObject heartbeatObject;
+    heartbeatObject["sent"]         = counter(heartbeat.sent);
+    heartbeatObject["answered"]     = counter(heartbeat.answered);
+    heartbeatObject["missed"]       = counter(heartbeat.missed);
+    heartbeatObject["lastRttMs"]    = heartbeat.lastRttMs;
+    heartbeatObject["minRttMs"]     = heartbeat.minRttMs;
+    heartbeatObject["maxRttMs"]     = heartbeat.maxRttMs;
+    heartbeatObject["meanRttMs"]    = heartbeat.meanRttMs();
+    heartbeatObject["rttHistogram"] = histogram; // bucket i up to 2^i ms
+
+    QJsonObject clickObject;
+    clickObject["decoded"]   = latencyToJson(clickToDecoded);
+    clickObject["displayed"] = latencyToJson(clickToDisplayed);
+    clickObject["unmatched"] = counter(unmatchedPresses);
+
+    QJsonObject stallObject;
+    stallObject["stalls"]           = counter(guiStalls);
+    stallObject["worstMs"]          = worstGuiStallMs;
+    stallObject["worstHandler"]     = worstGuiStallHandler;
+    stallObject["deferredTimeouts"] = counter(deferredTimeouts);
+
+    QJsonObject object;
+    object["timestampMs"] = timestampMs;
+    object["connected"]   = connected;
+    object["port"]        = portName;
+    object["connects"]    = counter(connects);
+    object["reconnects"]  = counter(reconnects);
+    object["link"]        = linkObject;
+    object["rtt"]         = rttObject;
+    object["heartbeat"]   = heartbeatObject;
+    object["clickToLed"]  = clickObject;
+    object["guiStalls"]   = stallObject;
+    object["interactive"] = laneToJson(interactive);
+    object["bulk"]        = laneToJson(bulk);
+
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <array>
+
+#include "LatencyHistogram.h"
+#include "SerialPortModel.h"
+
+// Round trips of the heartbeat Echo, measured by SerialPortConnectionManager
+struct HeartbeatStats
+{
+    // Bucket i counts round trips up to 2^i ms, the last one everything slower
+    static constexpr int kBuckets = 12;
+
+    quint64 sent{0};
+    quint64 answered{0};
+    quint64 missed{0};
+    double  lastRttMs{0.0};
+    double  minRttMs{0.0};
+    double  maxRttMs{0.0};
+    double  totalRttMs{0.0};
+
+    std::array<quint64, kBuckets> rttHistogram{};
+
+    void   addSample(double rttMs);
+    double meanRttMs() const;
+
+    static double bucketUpperBoundMs(int bucket);
+};
+
+// Link health as shown in the diagnostics panel and written to the metrics dump
+struct LinkDiagnostics
+{
+    bool    connected{false};
+    QString portName{};
+    quint64 connects{0};
+    quint64 reconnects{0}; // lost connections that restarted auto-connect
+
+    SerialPortModel::LinkStats link{};
+    SerialPortModel::LaneStats interactive{};
+    SerialPortModel::LaneStats bulk{};
+    quint64                    coalescedFrames{0};
+
+    double smoothedRttMs{0.0};
+    double rttVarianceMs{0.0};
+    int    ackTimeoutMs{0};
+    int    commandDelayMs{0};
+
+    HeartbeatStats heartbeat{};
+
+    // Click to LED latency of the current session, filled by KeyboardController
+    LatencySummary clickToDecoded{};
+    LatencySummary clickToDisplayed{};
+    quint64        unmatchedPresses{0};
+
+    // GUI event loop stalls and the response timeouts postponed because of them
+    quint64 guiStalls{0};
+    double  worstGuiStallMs{0.0};
+    QString worstGuiStallHandler{};
+    quint64 deferredTimeouts{0};
+
+    // Compact JSON object without a trailing newline, one per line in the dump
+    QByteArray toJson(qint64 timestampMs) const;
+};
@@ -0,0 +1,100 @@
+#include "LinkDiagnosticsPanel.h"
+
+#include <QFormLayout>
+#include <QLabel>
+#include <QWidget>
+
+#include "LinkDiagnostics.h"
+
+LinkDiagnosticsPanel::LinkDiagnosticsPanel(QWidget* parent) : QDockWidget(tr("Диагностика связи"), parent)
+{
+    setObjectName("LinkDiagnosticsPanel");
+
+    auto* content = new QWidget(this);
+    m_form        = new QFormLayout(content);
+    m_form->setLabelAlignment(Qt::AlignLeft);
+    setWidget(content);
+}
+
+void LinkDiagnosticsPanel::showDiagnostics(const LinkDiagnostics& diagnostics)
+{
+    if (!isVisible())
+    {
+        return;
+    }
+
+    const auto& link      = diagnostics.link;
+    const auto& heartbeat = diagnostics.heartbeat;
+
+    setValue(tr("Порт"), diagnostics.connected ? diagnostics.portName : tr("не подключено"));
+    setValue(tr("Подключений / обрывов"), QString("%1 / %2").arg(diagnostics.connects).arg(diagnostics.reconnects));
+    setValue(tr("Кадров принято / отправлено"), QString("%1 / %2").arg(link.framesRx).arg(link.framesTx));
+    setValue(tr("Байт принято / отправлено"), QString("%1 / %2").arg(link.bytesRx).arg(link.bytesTx));
+    setValue(tr("Ошибок контрольной суммы"), QString::number(link.checksumErrors));
+    setValue(tr("Пропущено байт до SOF"), QString::number(link.resyncBytes));
+    setValue(tr("Таймаутов ACK / повторов"), QString("%1 / %2").arg(link.ackTimeouts).arg(link.retries));
+    setValue(tr("Команд не доставлено"), QString::number(link.commandsFailed));
+    setValue(tr("Очередь, максимум"),
+             QString("%1 (в пути %2), объединено %3")
+                 .arg(link.queueHighWater)
+                 .arg(link.inFlightHighWater)
+                 .arg(diagnostics.coalescedFrames));
+    setValue(tr("RTT / разброс"),
+             QString("%1 / %2 мс").arg(diagnostics.smoothedRttMs, 0, 'f', 2).arg(diagnostics.rttVarianceMs, 0, 'f', 2));
+    setValue(tr("Таймаут ACK / пауза"),
+             QString("%1 / %2 мс").arg(diagnostics.ackTimeoutMs).arg(diagnostics.commandDelayMs));
+    setValue(tr("Heartbeat: ответов / пропусков"),
+             QString("%1 из %2 / %3").arg(heartbeat.answered).arg(heartbeat.sent).arg(heartbeat.missed));
+    setValue(tr("Heartbeat RTT мин / сред / макс"),
+             QString("%1 / %2 / %3 мс")
+                 .arg(heartbeat.minRttMs, 0, 'f', 1)
+                 .arg(heartbeat.meanRttMs(), 0, 'f', 1)
+                 .arg(heartbeat.maxRttMs, 0, 'f', 1));
+
+    QString histogram;
+    for (int i = 0; i < HeartbeatStats::kBuckets; ++i)
+    {
+        if (heartbeat.rttHistogram[i] == 0)
+        {
+            continue;
+        }
+        const bool    last  = i == HeartbeatStats::kBuckets - 1;
+        const QString bound = last ? QString(">%1").arg(HeartbeatStats::bucketUpperBoundMs(i - 1))
+                                   : QString("≤%1").arg(HeartbeatStats::bucketUpperBoundMs(i));
+        histogram.append(QString("%1: %2  ").arg(bound).arg(heartbeat.rttHistogram[i]));
+    }
+    setValue(tr("Heartbeat RTT, мс: кол-во"), histogram.trimmed());
+
+    const auto latency = [](const LatencySummary& summary)
+    {
+        return QString("%1 / %2 / %3 мс (%4)")
+            .arg(summary.p50Us / 1000.0, 0, 'f', 1)
+            .arg(summary.p99Us / 1000.0, 0, 'f', 1)
+            .arg(summary.p999Us / 1000.0, 0, 'f', 1)
+            .arg(static_cast<qint64>(summary.count));
+    };
+    setValue(tr("Клик → кадр p50 / p99 / p99.9"), latency(diagnostics.clickToDecoded));
+    setValue(tr("Клик → экран p50 / p99 / p99.9"), latency(diagnostics.clickToDisplayed));
+    setValue(tr("Нажатий без ответа"), QString::number(diagnostics.unmatchedPresses));
+
+    const QString stallHandler =
+        diagnostics.worstGuiStallHandler.isEmpty() ? tr("неизвестно") : diagnostics.worstGuiStallHandler;
+    const QString worstStall = QString("%1, худшее %2 мс (%3)")
+                                   .arg(diagnostics.guiStalls)
+                                   .arg(diagnostics.worstGuiStallMs, 0, 'f', 0)
+                                   .arg(diagnostics.guiStalls == 0 ? QString("-") : stallHandler);
+    setValue(tr("Зависаний интерфейса"), worstStall);
+    setValue(tr("Отложено таймаутов Echo"), QString::number(diagnostics.deferredTimeouts));
+}
+
+void LinkDiagnosticsPanel::setValue(const QString& row, const QString& value)
+{
+    QLabel*& label = m_values[row];
+    if (!label)
+    {
+        label = new QLabel(widget());
+        label->setTextInteractionFlags(Qt::TextSelectableByMouse);
+        m_form->addRow(row, label);
+    }
+    label->setText(value);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QDockWidget>
+#include <QHash>
+#include <QString>
+
+class QFormLayout;
+class QLabel;
+struct LinkDiagnostics;
+
+// Live link health, docked next to the scene and toggled from the COM port menu
+class LinkDiagnosticsPanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LinkDiagnosticsPanel(QWidget* parent = nullptr);
+
+public slots:
+    void showDiagnostics(const LinkDiagnostics& diagnostics);
+
+private:
+    void setValue(const QString& row, const QString& value);
+
+    QFormLayout*            m_form{nullptr};
+    QHash<QString, QLabel*> m_values{};
+};
@@ -0,0 +1,120 @@
+#include "LoopbackTransport.h"
+
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <vector>
+
+struct LoopbackTransport::Channel
+{
+    QMutex               mutex;
+    std::vector<uint8_t> pending[2]; // bytes waiting to be read by each side
+    LoopbackTransport*   ends[2]{nullptr, nullptr};
+    bool                 notifyPending[2]{false, false};
+};
+
+LoopbackTransport::Pair LoopbackTransport::createPair()
+{
+    auto channel = std::make_shared<Channel>();
+
+    Pair pair{std::unique_ptr<LoopbackTransport>(new LoopbackTransport(channel, 0)),
+              std::unique_ptr<LoopbackTransport>(new LoopbackTransport(channel, 1))};
+    channel->ends[0] = pair.first.get();
+    channel->ends[1] = pair.second.get();
+    return pair;
+}
+
+LoopbackTransport::LoopbackTransport(std::shared_ptr<Channel> channel, int side)
+    : m_channel(std::move(channel)), m_side(side)
+{
+}
+
+LoopbackTransport::~LoopbackTransport()
+{
+    QMutexLocker lock(&m_channel->mutex);
+    m_channel->ends[m_side] = nullptr;
+}
+
+bool LoopbackTransport::open()
+{
+    m_open = true;
+    return true;
+}
+
+void LoopbackTransport::close()
+{
+    m_open = false;
+    clear();
+}
+
+bool LoopbackTransport::isOpen() const
+{
+    return m_open;
+}
+
+int64_t LoopbackTransport::read(uint8_t* data, size_t maxSize)
+{
+    if (!m_open)
+    {
+        return -1;
+    }
+
+    QMutexLocker lock(&m_channel->mutex);
+    auto&        pending = m_channel->pending[m_side];
+    const size_t count   = std::min(maxSize, pending.size());
+    std::copy_n(pending.begin(), count, data);
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(count));
+    return static_cast<int64_t>(count);
+}
+
+int64_t LoopbackTransport::write(const uint8_t* data, size_t size)
+{
+    if (!m_open)
+    {
+        return -1;
+    }
+
+    const int    peerSide = 1 - m_side;
+    QMutexLocker lock(&m_channel->mutex);
+
+    // like an unplugged cable, nobody is listening on the other side
+    LoopbackTransport* peer = m_channel->ends[peerSide];
+    if (!peer || !peer->m_open)
+    {
+        return static_cast<int64_t>(size);
+    }
+
+    m_channel->pending[peerSide].insert(m_channel->pending[peerSide].end(), data, data + size);
+    if (!m_channel->notifyPending[peerSide])
+    {
+        m_channel->notifyPending[peerSide] = true;
+        QMetaObject::invokeMethod(peer, [peer]() { peer->notifyReadyRead(); }, Qt::QueuedConnection);
+    }
+    return static_cast<int64_t>(size);
+}
+
+void LoopbackTransport::clear()
+{
+    QMutexLocker lock(&m_channel->mutex);
+    m_channel->pending[m_side].clear();
+}
+
+QString LoopbackTransport::description() const
+{
+    return QString("loopback end %1").arg(m_side);
+}
+
+QString LoopbackTransport::errorString() const
+{
+    return {};
+}
+
+void LoopbackTransport::notifyReadyRead()
+{
+    {
+        QMutexLocker lock(&m_channel->mutex);
+        m_channel->notifyPending[m_side] = false;
+    }
+    emit readyRead();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "ITransport.h"
+
+// In-memory byte pipe, what one end writes the other end reads.
+// Drives the worker against an in-process device model at memory speed, without a tty.
+// The two ends may live on different threads, readyRead is emitted on the receiver's thread
+// once per batch of writes.
+class LoopbackTransport : public ITransport
+{
+    Q_OBJECT
+
+public:
+    using Pair = std::pair<std::unique_ptr<LoopbackTransport>, std::unique_ptr<LoopbackTransport>>;
+
+    static Pair createPair();
+
+    ~LoopbackTransport() override;
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override;
+
+    int64_t read(uint8_t* data, size_t maxSize) override;
+    int64_t write(const uint8_t* data, size_t size) override;
+
+    void clear() override;
+
+    QString description() const override;
+    QString errorString() const override;
+
+private:
+    struct Channel;
+
+    LoopbackTransport(std::shared_ptr<Channel> channel, int side);
+
+    void notifyReadyRead();
+
+    std::shared_ptr<Channel> m_channel;
+    int                      m_side;
+    std::atomic<bool>        m_open{false}; // read by the peer when it writes
+};
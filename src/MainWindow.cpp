@@ -11,7 +11,9 @@
 #include <QWindow>
 
 #include "ComPortMenu.h"
+#include "EventLoopWatchdog.h"
 #include "ImageZoomWidget.h"
+#include "LinkDiagnosticsPanel.h"
 #include "ProjectIO.h"
 #include "QtFileDialogService.h"
 #include "QtMessageService.h"
@@ -47,6 +49,28 @@ MainWindow::MainWindow(QWidget* parent)
     connect(this, &MainWindow::modifyModStatusChanged, scene, &CustomScene::setModifiable);
     connect(this, &MainWindow::modifyModStatusChanged, sceneController, &SceneController::setModifyMode);
 
+    // status is applied as a difference to the previous frame, start each mode from a clean scene
+    connect(this,
+            &MainWindow::workingModStatusChanged,
+            sceneController,
+            [this](bool isActive)
+            {
+                if (isActive)
+                {
+                    sceneController->clearDiodeStatus();
+                }
+            });
+    connect(this,
+            &MainWindow::checkModStatusChanged,
+            sceneController,
+            [this](bool isActive)
+            {
+                if (isActive)
+                {
+                    sceneController->clearButtonStatus();
+                }
+            });
+
     createImageViewer();
 
     stackedWidget->addWidget(startScreen);
@@ -242,8 +266,6 @@ void MainWindow::bindDiodeItem(DiodeItem* diode)
             this,
             [this](Pins pins) { emit appExecuteCommand(Command::DiodeReleased, pins); });
 
-    connect(this, &MainWindow::updateDiodeStatus, diode, &DiodeItem::onStatusUpdate);
-    connect(this, &MainWindow::clearDiodeStatus, diode, &DiodeItem::clearStatus);
     connect(this, &MainWindow::checkModStatusChanged, diode, &DiodeItem::setClickable);
 
     connect(this,
@@ -273,8 +295,6 @@ void MainWindow::bindButtonItem(ButtonItem* button)
             &ButtonItem::buttonReleased,
             this,
             [this](Pins pins) { emit appExecuteCommand(Command::ButtonReleased, pins); });
-    connect(this, &MainWindow::updateButtonStatus, button, &ButtonItem::onStatusUpdate);
-    connect(this, &MainWindow::clearButtonStatus, button, &ButtonItem::clearStatus);
     connect(this, &MainWindow::workingModStatusChanged, button, &ButtonItem::setClickable);
 
     connect(this,
@@ -306,11 +326,16 @@ void MainWindow::setupMenus()
     comPortMenu = new ComPortMenu(this, this);
     connect(comPortMenu, &ComPortMenu::refreshRequested, this, &MainWindow::refreshComPortList);
 
+    diagnosticsPanel = new LinkDiagnosticsPanel(this);
+    addDockWidget(Qt::RightDockWidgetArea, diagnosticsPanel);
+    diagnosticsPanel->hide();
+    comPortMenu->addPanelAction(diagnosticsPanel->toggleViewAction());
+
     QMenu* versionMenu = menuBar()->addMenu("Версия ПО");
     versionMenu->addAction(QStringLiteral(APP_VERSION));
 }
 
-void MainWindow::updateStatus(Pins pins, const QVector<Pins>& leds)
+void MainWindow::updateStatus(Pins pins, const LedList& leds)
 {
     const WorkMode mode = currentMode();
     if (mode == WorkMode::Modify || mode == WorkMode::DiodeConf)
@@ -320,18 +345,12 @@ void MainWindow::updateStatus(Pins pins, const QVector<Pins>& leds)
 
     if (mode == WorkMode::Work)
     {
-        emit clearDiodeStatus();
-        for (const auto& led : leds)
-        {
-            emit updateDiodeStatus(led);
-        }
-
+        sceneController->applyDiodeStatus(leds);
         return;
     }
 
     if (mode == WorkMode::Check)
     {
-        emit    clearButtonStatus();
         QString statusText      = QString("Pins: P1:%1, P2:%2, LEDs: ").arg(pins.pin1).arg(pins.pin2);
         int     countActiveLeds = 0;
         for (const auto& led : leds)
@@ -349,7 +368,7 @@ void MainWindow::updateStatus(Pins pins, const QVector<Pins>& leds)
             workModeUi->setStatusText(statusText);
         }
 
-        emit updateButtonStatus(pins, true);
+        sceneController->applyButtonStatus(pins);
     }
 }
 
@@ -371,6 +390,19 @@ void MainWindow::updateComPort(const QString& portName)
     }
 }
 
+void MainWindow::updateDiagnostics(const LinkDiagnostics& diagnostics)
+{
+    if (diagnosticsPanel)
+    {
+        diagnosticsPanel->showDiagnostics(diagnostics);
+    }
+}
+
+bool MainWindow::isDiagnosticsVisible() const
+{
+    return diagnosticsPanel && diagnosticsPanel->isVisible();
+}
+
 void MainWindow::showWarning(const QString& title, const QString& text)
 {
     if (messageService)
@@ -417,6 +449,7 @@ void MainWindow::saveProject()
         project.background = sceneController->background().toImage();
     }
 
+    EventLoopWatchdog::HandlerScope handler("save project");
     LOG_INFO << "Saving project to " << path.toStdString() << std::endl;
     if (!ProjectIO::save(path, project))
     {
@@ -458,6 +491,8 @@ bool MainWindow::loadProjectFromPath(const QString& path)
         return false;
     }
 
+    EventLoopWatchdog::HandlerScope handler("load project");
+
     Project project;
     LOG_INFO << "Loading project from " << path.toStdString() << std::endl;
     if (!ProjectIO::load(path, project))
@@ -15,12 +15,15 @@
 #include "IMessageService.h"
 #include "PinsDefinition.h"
 #include "RecentProjects.h"
+#include "StatusFrame.h"
 #include "WorkMode.h"
 #include "WorkModeState.h"
 
 class ImageZoomWidget;
 class StartScreenWidget;
 class ComPortMenu;
+class LinkDiagnosticsPanel;
+struct LinkDiagnostics;
 class WorkModeToolbar;
 class SceneController;
 class WorkModeState;
@@ -32,6 +35,8 @@ class MainWindow : public QMainWindow
 public:
     explicit MainWindow(QWidget* parent = nullptr);
 
+    bool isDiagnosticsVisible() const;
+
 signals:
     // View → Controller
     void appExecuteCommand(Command command, Pins pins = {0, 0});
@@ -41,13 +46,6 @@ signals:
 
     void comPortSelected(const QString& portName);
 
-    void updateDiodeStatus(Pins pins);
-
-    void updateButtonStatus(Pins pins, bool isPressed);
-
-    void clearButtonStatus();
-    void clearDiodeStatus();
-
     void workModeChanged(WorkMode mode);
 
     void modifyModStatusChanged(bool isModifiable);
@@ -60,11 +58,12 @@ signals:
 
 public slots:
     // Controller → View
-    void updateStatus(Pins pins, const QVector<Pins>& leds);
+    void updateStatus(Pins pins, const LedList& leds);
 
     void updatePinStatus(AbstractItem* item);
 
     void updateComPort(const QString& portName);
+    void updateDiagnostics(const LinkDiagnostics& diagnostics);
     void showWarning(const QString& title, const QString& text);
 
 private slots:
@@ -115,6 +114,8 @@ private:
     WorkModeToolbar* workModeUi{nullptr};
     WorkModeState*   workModeState{nullptr};
     ComPortMenu*     comPortMenu{nullptr};
+
+    LinkDiagnosticsPanel* diagnosticsPanel{nullptr};
     SceneController* sceneController{nullptr};
 
     std::unique_ptr<IFileDialogService> fileDialogs;
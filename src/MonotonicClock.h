@@ -0,0 +1,12 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Steady clock in microseconds, comparable between threads
+inline int64_t monotonicUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
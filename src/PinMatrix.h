@@ -0,0 +1,45 @@
+#pragma once
+
+#include <bitset>
+
+#include "KeyboardControllerProtocol.h"
+#include "PinsDefinition.h"
+
+// Dense numbering of the 15x15 (pin1, pin2) matrix, pins are 1-based
+namespace PinMatrix
+{
+constexpr int kPinCount = 15;
+constexpr int kSize     = kPinCount * kPinCount;
+
+using Set = std::bitset<kSize>;
+
+// -1 for pins outside the matrix
+constexpr int indexOf(int pin1, int pin2)
+{
+    if (pin1 < 1 || pin1 > kPinCount || pin2 < 1 || pin2 > kPinCount)
+    {
+        return -1;
+    }
+
+    return (pin1 - 1) * kPinCount + (pin2 - 1);
+}
+
+constexpr Pins pinsAt(int index)
+{
+    return Pins{static_cast<uint8_t>(index / kPinCount + 1), static_cast<uint8_t>(index % kPinCount + 1)};
+}
+
+// Digest of a diode table as reported in DiodeDigestPayload, the index order is the (pin1, pin2) order
+inline uint32_t digestOf(const Set& diodes)
+{
+    uint32_t digest = PROTOCOL_DIODE_DIGEST_BASIS;
+    for (int index = 0; index < kSize; ++index)
+    {
+        if (diodes.test(index))
+        {
+            digest = diode_digest_add(digest, pinsAt(index));
+        }
+    }
+    return digest;
+}
+} // namespace PinMatrix
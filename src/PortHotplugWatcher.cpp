@@ -0,0 +1,97 @@
+#include "PortHotplugWatcher.h"
+
+#include <QSocketNotifier>
+#include <QtGlobal>
+#include <cerrno>
+#include <cstring>
+
+#include "logger.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef Q_OS_LINUX
+bool isSerialDeviceName(const char* name)
+{
+    // same filter as SerialPortConnectionManager::collectPortNames()
+    return std::strncmp(name, "ttyUSB", 6) == 0;
+}
+#endif
+} // namespace
+
+PortHotplugWatcher::PortHotplugWatcher(QObject* parent) : QObject(parent)
+{
+#ifdef Q_OS_LINUX
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+    {
+        LOG_WRN << "inotify is not available: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    // IN_ATTRIB: udev fixes the node permissions right after creating it
+    if (inotify_add_watch(m_fd, "/dev", IN_CREATE | IN_DELETE | IN_ATTRIB) < 0)
+    {
+        LOG_WRN << "Cannot watch /dev: " << std::strerror(errno) << std::endl;
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &PortHotplugWatcher::readEvents);
+    LOG_INFO << "Watching /dev for serial port hotplug" << std::endl;
+#endif
+}
+
+PortHotplugWatcher::~PortHotplugWatcher()
+{
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0)
+    {
+        delete m_notifier;
+        ::close(m_fd);
+    }
+#endif
+}
+
+bool PortHotplugWatcher::isActive() const
+{
+    return m_fd >= 0;
+}
+
+void PortHotplugWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(inotify_event) char buffer[4096];
+
+    bool changed = false;
+    for (;;)
+    {
+        const ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && isSerialDeviceName(event->name))
+            {
+                changed = true;
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+
+    if (changed)
+    {
+        emit portsChanged();
+    }
+#endif
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QObject>
+
+class QSocketNotifier;
+
+// Reports serial device nodes appearing in or disappearing from /dev.
+// Uses inotify on Linux, elsewhere isActive() is false and the caller has to poll.
+class PortHotplugWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PortHotplugWatcher(QObject* parent = nullptr);
+    ~PortHotplugWatcher();
+
+    bool isActive() const;
+
+signals:
+    void portsChanged();
+
+private slots:
+    void readEvents();
+
+private:
+    int              m_fd{-1};
+    QSocketNotifier* m_notifier{nullptr};
+};
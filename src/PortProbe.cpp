@@ -0,0 +1,99 @@
+#include "PortProbe.h"
+
+#include <algorithm>
+
+#include "logger.h"
+
+PortProbe::PortProbe(const QString& portName, int baudRate, QObject* parent)
+    : QObject(parent), m_transport(std::make_unique<SerialTransport>(portName, baudRate)), m_portName(portName)
+{
+    connect(m_transport.get(), &ITransport::readyRead, this, &PortProbe::handleReadyRead);
+}
+
+PortProbe::~PortProbe()
+{
+    if (m_transport && m_transport->isOpen())
+    {
+        m_transport->close();
+    }
+}
+
+bool PortProbe::start()
+{
+    if (!m_transport->open())
+    {
+        LOG_WRN << "Failed to open COM port " << m_portName.toStdString() << ": "
+                << m_transport->errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    m_transport->clear();
+
+    const std::vector<uint8_t> echo = build_packet(Command::Echo, nullptr, 0);
+    m_transport->write(echo.data(), echo.size());
+    return true;
+}
+
+QString PortProbe::portName() const
+{
+    return m_portName;
+}
+
+uint8_t PortProbe::capabilities() const
+{
+    return m_capabilities;
+}
+
+std::unique_ptr<ITransport> PortProbe::takeTransport()
+{
+    if (m_transport)
+    {
+        m_transport->disconnect(this);
+    }
+    return std::move(m_transport);
+}
+
+void PortProbe::handleReadyRead()
+{
+    // only the first answer counts, later bytes belong to whoever took the port
+    if (m_answered || !m_transport)
+    {
+        return;
+    }
+
+    uint8_t chunk[FrameParser::kCapacity];
+
+    while (!m_answered)
+    {
+        const int64_t read = m_transport->read(chunk, std::min(sizeof(chunk), m_parser.freeSpace()));
+        if (read <= 0)
+        {
+            break;
+        }
+
+        m_parser.feed(chunk, static_cast<size_t>(read));
+        m_parser.drain(
+            [this](std::span<const uint8_t> frame)
+            {
+                const Packet* packet = reinterpret_cast<const Packet*>(frame.data());
+                if (m_answered || command_from_byte(static_cast<uint8_t>(packet->command)) != Command::Echo)
+                {
+                    return;
+                }
+
+                // payload sits between the command and the checksum
+                m_answered = true;
+                if (frame.size() >= offsetof(Packet, payload) + sizeof(EchoReplyPayload) + 1)
+                {
+                    const auto* reply = reinterpret_cast<const EchoReplyPayload*>(&frame[offsetof(Packet, payload)]);
+                    m_capabilities    = reply->capabilities;
+                }
+            });
+    }
+
+    if (m_answered)
+    {
+        // the port stays open for takeTransport()
+        emit echoReceived(m_portName);
+    }
+}
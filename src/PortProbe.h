@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <memory>
+
+#include "FrameParser.h"
+#include "SerialTransport.h"
+
+// Minimal transport used while looking for the device: opens one port, writes a single Echo
+// and reports the first valid Echo reply. Many probes run side by side, one per candidate port.
+// The winning probe hands its open port over, so the connection needs no second open or Echo.
+class PortProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    PortProbe(const QString& portName, int baudRate, QObject* parent = nullptr);
+    ~PortProbe();
+
+    // Opens the port and sends the Echo request, false if the port cannot be opened
+    bool start();
+
+    QString portName() const;
+
+    // Capabilities from the Echo reply, valid once echoReceived was emitted
+    uint8_t capabilities() const;
+
+    // Gives up the still open port, the probe is done afterwards
+    std::unique_ptr<ITransport> takeTransport();
+
+signals:
+    void echoReceived(const QString& portName);
+
+private slots:
+    void handleReadyRead();
+
+private:
+    std::unique_ptr<SerialTransport> m_transport;
+    FrameParser                      m_parser;
+    QString                          m_portName;
+    bool                             m_answered{false};
+    uint8_t                          m_capabilities{0};
+};
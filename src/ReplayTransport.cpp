@@ -0,0 +1,138 @@
+#include "ReplayTransport.h"
+
+#include <algorithm>
+
+#include "logger.h"
+
+ReplayTransport::ReplayTransport(const QString& path, Speed speed, QObject* parent)
+    : ITransport(parent), m_path(path), m_speed(speed), m_timer(this)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &ReplayTransport::playDue);
+}
+
+bool ReplayTransport::open()
+{
+    close();
+    m_records.clear();
+
+    WireCaptureReader reader;
+    if (!reader.open(m_path.toStdString()))
+    {
+        m_error = QString("Cannot read capture %1").arg(m_path);
+        return false;
+    }
+
+    // transmitted frames were written by the host, only the device side is replayed
+    WireRecord record;
+    while (reader.next(record))
+    {
+        if (record.direction == WireDirection::Rx)
+        {
+            m_records.push_back(std::move(record));
+        }
+    }
+
+    LOG_INFO << "Loaded " << m_records.size() << " received records from " << m_path.toStdString() << std::endl;
+
+    m_next = 0;
+    m_open = true;
+    m_clock.start();
+    m_timer.start(0);
+    return true;
+}
+
+void ReplayTransport::close()
+{
+    m_timer.stop();
+    m_open = false;
+    clear();
+}
+
+bool ReplayTransport::isOpen() const
+{
+    return m_open;
+}
+
+int64_t ReplayTransport::read(uint8_t* data, size_t maxSize)
+{
+    const size_t count = std::min(maxSize, m_pending.size() - m_pendingOffset);
+    std::copy_n(m_pending.begin() + static_cast<std::ptrdiff_t>(m_pendingOffset), count, data);
+    m_pendingOffset += count;
+    if (m_pendingOffset == m_pending.size())
+    {
+        clear();
+    }
+    return static_cast<int64_t>(count);
+}
+
+int64_t ReplayTransport::write(const uint8_t*, size_t size)
+{
+    return static_cast<int64_t>(size);
+}
+
+void ReplayTransport::clear()
+{
+    m_pending.clear();
+    m_pendingOffset = 0;
+}
+
+QString ReplayTransport::description() const
+{
+    return QString("replay of %1").arg(m_path);
+}
+
+QString ReplayTransport::errorString() const
+{
+    return m_error;
+}
+
+bool ReplayTransport::isFinished() const
+{
+    return m_next == m_records.size();
+}
+
+void ReplayTransport::playDue()
+{
+    const uint64_t firstUs   = m_records.empty() ? 0 : m_records.front().timestampUs;
+    const uint64_t elapsedUs = static_cast<uint64_t>(m_clock.nsecsElapsed() / 1000);
+
+    size_t played = 0;
+    while (m_next < m_records.size() && played < kMaxBurst)
+    {
+        const WireRecord& record = m_records[m_next];
+        const uint64_t    dueUs  = record.timestampUs - firstUs;
+        if (m_speed == Speed::Original && dueUs > elapsedUs)
+        {
+            break;
+        }
+
+        m_pending.insert(m_pending.end(), record.data.begin(), record.data.end());
+        ++m_next;
+        ++played;
+    }
+
+    if (played > 0)
+    {
+        // the reader may close the transport from within readyRead
+        emit readyRead();
+        if (!m_open)
+        {
+            return;
+        }
+    }
+
+    if (m_next < m_records.size())
+    {
+        // rounded up: a gap under 1 ms must not become a 0 ms timer that spins until the record is due
+        const uint64_t dueUs = m_records[m_next].timestampUs - firstUs;
+        const uint64_t nowUs = static_cast<uint64_t>(m_clock.nsecsElapsed() / 1000);
+        const bool     wait  = m_speed == Speed::Original && dueUs > nowUs;
+        m_timer.start(wait ? static_cast<int>((dueUs - nowUs + 999) / 1000) : 0);
+        return;
+    }
+
+    LOG_INFO << "Capture replay finished" << std::endl;
+    emit finished();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QTimer>
+#include <vector>
+
+#include "ITransport.h"
+#include "WireCapture.h"
+
+// Plays the received side of a wire capture back as if it came from the port.
+// Passive: writes are discarded, the recorded replies belong to the original session.
+class ReplayTransport : public ITransport
+{
+    Q_OBJECT
+
+public:
+    enum class Speed
+    {
+        Original, // keeps the recorded gaps between reads
+        Maximum   // as fast as the consumer takes it
+    };
+
+    ReplayTransport(const QString& path, Speed speed, QObject* parent = nullptr);
+
+    // Loads the capture and starts playing it
+    bool open() override;
+    void close() override;
+    bool isOpen() const override;
+
+    int64_t read(uint8_t* data, size_t maxSize) override;
+    int64_t write(const uint8_t* data, size_t size) override;
+
+    void clear() override;
+
+    bool isPassive() const override { return true; }
+
+    QString description() const override;
+    QString errorString() const override;
+
+    // All records have been handed out, the transport stays open
+    bool isFinished() const;
+
+signals:
+    void finished();
+
+private slots:
+    void playDue();
+
+private:
+    QString m_path;
+    Speed   m_speed;
+    QString m_error;
+
+    std::vector<WireRecord> m_records;
+    size_t                  m_next{0};
+    bool                    m_open{false};
+    QTimer                  m_timer;
+    QElapsedTimer           m_clock;
+
+    // Played but not read yet
+    std::vector<uint8_t> m_pending;
+    size_t               m_pendingOffset{0};
+
+    // Records per event loop pass at maximum speed, keeps the worker responsive to close()
+    static constexpr size_t kMaxBurst = 256;
+};
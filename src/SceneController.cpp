@@ -8,6 +8,7 @@
 #include "CustomScene.h"
 #include "DiodeItem.h"
 #include "ResizableRectItem.h"
+#include "Tracer.h"
 
 SceneController::SceneController(CustomScene* scene, QObject* parent) : QObject(parent), m_scene(scene)
 {
@@ -51,6 +52,7 @@ void SceneController::setBackground(const QPixmap& pixmap)
 
     m_diodes.clear();
     m_buttons.clear();
+    clearPinIndex();
     clearClipboard();
 }
 
@@ -91,6 +93,96 @@ void SceneController::addExistingButton(ButtonItem* button)
     registerButton(button, /*createdByScene=*/false);
 }
 
+void SceneController::applyDiodeStatus(const LedList& leds)
+{
+    PinMatrix::Set lit;
+    for (const Pins& led : leds)
+    {
+        const int slot = PinMatrix::indexOf(led.pin1, led.pin2);
+        if (slot >= 0)
+        {
+            lit.set(slot);
+        }
+    }
+
+    const PinMatrix::Set flipped = lit ^ m_litDiodes;
+    m_litDiodes                  = lit;
+    if (flipped.none())
+    {
+        return;
+    }
+
+    TraceScope trace(TraceTrack::Scene, "apply LEDs");
+    trace.setArg("changed", flipped.count());
+
+    // the scene collects the dirty items and repaints them in one pass
+    for (size_t slot = 0; slot < flipped.size(); ++slot)
+    {
+        if (!flipped.test(slot))
+        {
+            continue;
+        }
+
+        for (AbstractItem* item : m_diodesByPins[slot])
+        {
+            item->setStatus(lit.test(slot));
+        }
+    }
+}
+
+void SceneController::applyButtonStatus(Pins pins)
+{
+    const int slot = PinMatrix::indexOf(pins.pin1, pins.pin2);
+    if (slot == m_litButtonSlot)
+    {
+        return;
+    }
+
+    clearButtonStatus();
+
+    if (slot < 0)
+    {
+        return;
+    }
+
+    for (AbstractItem* item : m_buttonsByPins[slot])
+    {
+        item->setStatus(true);
+    }
+    m_litButtonSlot = slot;
+}
+
+void SceneController::clearDiodeStatus()
+{
+    for (size_t slot = 0; slot < m_litDiodes.size(); ++slot)
+    {
+        if (!m_litDiodes.test(slot))
+        {
+            continue;
+        }
+
+        for (AbstractItem* item : m_diodesByPins[slot])
+        {
+            item->setStatus(false);
+        }
+    }
+    m_litDiodes.reset();
+}
+
+void SceneController::clearButtonStatus()
+{
+    if (m_litButtonSlot < 0)
+    {
+        return;
+    }
+
+    for (AbstractItem* item : m_buttonsByPins[m_litButtonSlot])
+    {
+        item->setStatus(false);
+    }
+    m_litButtonSlot = -1;
+}
+
 void SceneController::copyItem(ResizableRectItem* item)
 {
     if (!item)
@@ -162,6 +254,18 @@ void SceneController::handleScenePaste(QPointF pos)
     }
 }
 
+void SceneController::handlePinsChanged(AbstractItem* item)
+{
+    if (!item || !m_indexedSlots.contains(item))
+    {
+        return;
+    }
+
+    PinIndex& index = dynamic_cast<DiodeItem*>(item) ? m_diodesByPins : m_buttonsByPins;
+    unindexItem(index, item);
+    indexItem(index, item);
+}
+
 void SceneController::registerDiode(DiodeItem* diode, bool createdByScene)
 {
     if (!diode)
@@ -170,8 +274,10 @@ void SceneController::registerDiode(DiodeItem* diode, bool createdByScene)
     }
 
     m_diodes.append(diode);
+    indexItem(m_diodesByPins, diode);
     registerResizable(diode);
     connect(diode, &DiodeItem::removeItem, this, &SceneController::deleteItem);
+    connect(diode, &DiodeItem::pinsChanged, this, &SceneController::handlePinsChanged);
     emit diodeReady(diode);
 
     if (createdByScene)
@@ -188,8 +294,10 @@ void SceneController::registerButton(ButtonItem* button, bool createdByScene)
     }
 
     m_buttons.append(button);
+    indexItem(m_buttonsByPins, button);
     registerResizable(button);
     connect(button, &ButtonItem::removeItem, this, &SceneController::deleteItem);
+    connect(button, &ButtonItem::pinsChanged, this, &SceneController::handlePinsChanged);
     emit buttonReady(button);
 
     if (createdByScene)
@@ -217,6 +325,7 @@ void SceneController::removeDiode(DiodeItem* diode)
         m_scene->removeItem(diode);
     }
     m_diodes.removeOne(diode);
+    unindexItem(m_diodesByPins, diode);
     delete diode;
 }
 
@@ -233,6 +342,7 @@ void SceneController::removeButton(ButtonItem* button)
         m_scene->removeItem(button);
     }
     m_buttons.removeOne(button);
+    unindexItem(m_buttonsByPins, button);
     delete button;
 }
 
@@ -249,3 +359,43 @@ void SceneController::updatePasteAvailability() const
         m_scene->setPasteEnabled(m_copiedItem != nullptr);
     }
 }
+
+void SceneController::indexItem(PinIndex& index, AbstractItem* item)
+{
+    const int slot = PinMatrix::indexOf(item->getPin1(), item->getPin2());
+    if (slot >= 0)
+    {
+        index[slot].append(item);
+    }
+    m_indexedSlots.insert(item, slot);
+
+    // keep the item in line with the last applied frame, it is not compared again until its slot flips
+    const bool isDiodeIndex = &index == &m_diodesByPins;
+    const bool lit          = slot >= 0 && (isDiodeIndex ? m_litDiodes.test(slot) : slot == m_litButtonSlot);
+    item->setStatus(lit);
+}
+
+void SceneController::unindexItem(PinIndex& index, AbstractItem* item)
+{
+    const int slot = m_indexedSlots.value(item, -1);
+    if (slot >= 0)
+    {
+        index[slot].removeOne(item);
+    }
+    m_indexedSlots.remove(item);
+}
+
+void SceneController::clearPinIndex()
+{
+    for (auto& items : m_diodesByPins)
+    {
+        items.clear();
+    }
+    for (auto& items : m_buttonsByPins)
+    {
+        items.clear();
+    }
+    m_indexedSlots.clear();
+    m_litDiodes.reset();
+    m_litButtonSlot = -1;
+}
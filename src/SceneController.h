@@ -1,10 +1,15 @@
 #pragma once
 
+#include <QHash>
 #include <QList>
 #include <QObject>
 #include <QPixmap>
+#include <array>
 #include <memory>
 
+#include "PinMatrix.h"
+#include "PinsDefinition.h"
+#include "StatusFrame.h"
 #include "WorkMode.h"
 
 class ButtonItem;
@@ -30,6 +35,13 @@ public:
     void addExistingDiode(DiodeItem* diode);
     void addExistingButton(ButtonItem* button);
 
+    // Status frames only touch the items registered under the reported pins.
+    // Diodes are compared with the previous frame and only flipped items are repainted.
+    void applyDiodeStatus(const LedList& leds);
+    void applyButtonStatus(Pins pins);
+    void clearDiodeStatus();
+    void clearButtonStatus();
+
 public slots:
     void setModifyMode(bool enabled);
     void copyItem(ResizableRectItem* item);
@@ -45,6 +57,7 @@ private slots:
     void handleSceneDiodeAdded(DiodeItem* diode);
     void handleSceneButtonAdded(ButtonItem* button);
     void handleScenePaste(QPointF pos);
+    void handlePinsChanged(AbstractItem* item);
 
 private:
     void registerDiode(DiodeItem* diode, bool createdByScene);
@@ -55,10 +68,23 @@ private:
     void clearClipboard();
     void updatePasteAvailability() const;
 
+    // (pin1, pin2) -> items
+    using PinIndex = std::array<QList<AbstractItem*>, PinMatrix::kSize>;
+
+    void indexItem(PinIndex& index, AbstractItem* item);
+    void unindexItem(PinIndex& index, AbstractItem* item);
+    void clearPinIndex();
+
     CustomScene*                       m_scene{nullptr};
     QList<DiodeItem*>                  m_diodes;
     QList<ButtonItem*>                 m_buttons;
     std::unique_ptr<ResizableRectItem> m_copiedItem;
     QPixmap                            m_background;
     bool                               m_modifyMode{false};
+
+    PinIndex                  m_diodesByPins;
+    PinIndex                  m_buttonsByPins;
+    QHash<AbstractItem*, int> m_indexedSlots; // slot an item is filed under, -1 for unset pins
+    PinMatrix::Set            m_litDiodes;
+    int                       m_litButtonSlot{-1};
 };
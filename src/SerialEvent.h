@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "CommandDefinition.h"
+#include "PinsDefinition.h"
+#include "SpscQueue.h"
+#include "StatusFrame.h"
+
+// Link parameters the worker thread publishes to the GUI thread
+struct LinkState
+{
+    uint32_t generation{0}; // incremented on every open/close of the port
+    uint8_t  capabilities{0};
+    double   smoothedRttMs{0.0};
+    double   rttVarianceMs{0.0};
+    int      ackTimeoutMs{0};
+    int      commandDelayMs{0};
+};
+
+// Decoded serial event handed from the I/O thread to the GUI thread
+struct SerialEvent
+{
+    enum class Type : uint8_t
+    {
+        Status,
+        CommandReceived,
+        Echo,
+        LinkStateChanged,
+        CommandFailed,
+        PortError,
+        DiodeDigest
+    };
+
+    Type     type{Type::Echo};
+    uint32_t generation{0};
+
+    Command       command{Command::None};
+    Pins          pins{0, 0};
+    LedList       leds; // inline, a status event never allocates
+    LinkState     link;
+    QString       error;
+    int64_t       timestampUs{0}; // monotonicUs() when a status frame was decoded
+    uint32_t      diodeDigest{0}; // DiodeDigestPayload of a DiodeDigest event
+    uint8_t       diodeCount{0};
+};
+
+// Single producer (I/O thread) / single consumer (GUI thread) event channel.
+// The producer wakes the consumer once per batch instead of once per event.
+class SerialEventChannel
+{
+public:
+    static constexpr size_t kCapacity = 1024;
+
+    explicit SerialEventChannel(std::function<void()> wakeConsumer) : m_wakeConsumer(std::move(wakeConsumer)) {}
+
+    // Producer side, returns false when the consumer fell behind and the queue is full
+    bool post(SerialEvent&& event)
+    {
+        if (!m_queue->tryPush(std::move(event)))
+        {
+            return false;
+        }
+
+        if (!m_wakePending.exchange(true, std::memory_order_acq_rel))
+        {
+            m_wakeConsumer();
+        }
+        return true;
+    }
+
+    // Consumer side
+    template <typename Handler>
+    void drain(Handler&& handler)
+    {
+        // cleared first, an event posted while draining schedules another wake-up
+        m_wakePending.store(false, std::memory_order_release);
+
+        SerialEvent event;
+        while (m_queue->tryPop(event))
+        {
+            handler(event);
+        }
+    }
+
+private:
+    std::unique_ptr<SpscQueue<SerialEvent, kCapacity>> m_queue{std::make_unique<SpscQueue<SerialEvent, kCapacity>>()};
+    std::atomic<bool>                                  m_wakePending{false};
+    std::function<void()>                              m_wakeConsumer;
+};
@@ -1,7 +1,11 @@
 #include "SerialPortConnectionManager.h"
 
+#include <QFileInfo>
+#include <QSettings>
+#include <QUrl>
 #include <QtGlobal>
 
+#include "Tracer.h"
 #include "logger.h"
 
 SerialPortConnectionManager::SerialPortConnectionManager(SerialPortModel* portModel, QObject* parent)
@@ -23,6 +27,14 @@ SerialPortConnectionManager::SerialPortConnectionManager(SerialPortModel* portMo
     m_portMonitorTimer.setSingleShot(false);
     connect(&m_portMonitorTimer, &QTimer::timeout, this, &SerialPortConnectionManager::monitorAvailablePorts);
 
+    m_hotplugSettleTimer.setSingleShot(true);
+    m_hotplugSettleTimer.setInterval(kHotplugSettleMs);
+    connect(&m_hotplugSettleTimer, &QTimer::timeout, this, &SerialPortConnectionManager::onHotplugSettled);
+    connect(&m_hotplugWatcher,
+            &PortHotplugWatcher::portsChanged,
+            &m_hotplugSettleTimer,
+            static_cast<void (QTimer::*)()>(&QTimer::start));
+
     m_lastObservedPorts = collectPortNames();
     updatePortMonitorState();
 }
@@ -37,6 +49,11 @@ QString SerialPortConnectionManager::currentPortName() const
     return m_currentPortName;
 }
 
+void SerialPortConnectionManager::setPortOverride(const PortOverride& portOverride)
+{
+    m_portOverride = portOverride;
+}
+
 void SerialPortConnectionManager::setHeartbeatInterval(int ms)
 {
     m_heartbeatIntervalMs = ms;
@@ -46,6 +63,38 @@ void SerialPortConnectionManager::setHeartbeatInterval(int ms)
     }
 }
 
+void SerialPortConnectionManager::setEventLoopWatchdog(const EventLoopWatchdog* watchdog)
+{
+    m_watchdog = watchdog;
+}
+
+LinkDiagnostics SerialPortConnectionManager::diagnostics() const
+{
+    LinkDiagnostics diagnostics;
+    diagnostics.connected       = isConnected();
+    diagnostics.portName        = m_currentPortName;
+    diagnostics.connects        = m_connects;
+    diagnostics.reconnects      = m_reconnects;
+    diagnostics.link            = m_portModel->linkStats();
+    diagnostics.interactive     = m_portModel->laneStats(SerialPortModel::Lane::Interactive);
+    diagnostics.bulk            = m_portModel->laneStats(SerialPortModel::Lane::Bulk);
+    diagnostics.coalescedFrames = m_portModel->coalescedFrames();
+    diagnostics.smoothedRttMs   = m_portModel->smoothedRttMs();
+    diagnostics.rttVarianceMs   = m_portModel->rttVarianceMs();
+    diagnostics.ackTimeoutMs    = m_portModel->ackTimeoutMs();
+    diagnostics.commandDelayMs  = m_portModel->commandDelayMs();
+    diagnostics.heartbeat       = m_heartbeat;
+    if (m_watchdog)
+    {
+        const EventLoopWatchdog::Stats stalls = m_watchdog->stats();
+        diagnostics.guiStalls                 = stalls.stalls;
+        diagnostics.worstGuiStallMs           = stalls.worstStallUs / 1000.0;
+        diagnostics.worstGuiStallHandler      = QString::fromLatin1(stalls.worstStallHandler);
+    }
+    diagnostics.deferredTimeouts = m_deferredTimeouts;
+    return diagnostics;
+}
+
 bool SerialPortConnectionManager::sendCommand(Command cmd)
 {
     if (!isConnected())
@@ -65,8 +114,34 @@ void SerialPortConnectionManager::startAutoConnect()
         return;
     }
 
-    LOG_INFO << "Starting auto-connect probing" << std::endl;
-    probePorts();
+    Tracer& tracer = Tracer::instance();
+    if (tracer.isEnabled() && m_connectTraceId == 0)
+    {
+        m_connectTraceId = tracer.nextId();
+        tracer.asyncBegin(TraceTrack::Connection, "auto-connect", m_connectTraceId);
+    }
+
+    if (!m_portOverride.replayFile.isEmpty())
+    {
+        startReplay();
+        return;
+    }
+
+    if (!m_portOverride.portName.isEmpty())
+    {
+        LOG_INFO << "Connecting to " << m_portOverride.portName.toStdString() << " given on the command line"
+                 << std::endl;
+        m_state = State::Probing;
+        openAndTestPort(m_portOverride.portName, m_responseTimeoutMs);
+        updatePortMonitorState();
+        return;
+    }
+
+    if (!tryLastKnownPort())
+    {
+        LOG_INFO << "Starting auto-connect probing" << std::endl;
+        probePorts();
+    }
     updatePortMonitorState();
 }
 
@@ -77,38 +152,106 @@ void SerialPortConnectionManager::stopAutoConnect()
         m_heartbeatTimer.stop();
     }
     m_responseTimer.stop();
+    stopProbes();
+    m_tryingLastKnownPort = false;
     m_portModel->closePort();
     m_state = State::Disconnected;
     m_currentPortName.clear();
+    endEchoTrace("stopped", 1);
+    endConnectTrace("stopped", 1);
     LOG_INFO << "Auto-connect stopped" << std::endl;
     emit disconnected();
     updatePortMonitorState();
 }
 
-void SerialPortConnectionManager::probePorts()
+void SerialPortConnectionManager::startReplay()
 {
-    m_ports.clear();
+    const QString& path = m_portOverride.replayFile;
+    if (!m_portModel->openReplay(path, m_portOverride.replaySpeed))
+    {
+        LOG_ERR << "Cannot replay capture " << path.toStdString() << std::endl;
+        emit connectionError(tr("Не удалось открыть запись %1").arg(path));
+        return;
+    }
 
-    for (const auto& info : QSerialPortInfo::availablePorts())
+    // a recording cannot answer a heartbeat, the session stays up until stopped
+    m_state           = State::Connected;
+    m_currentPortName = path;
+    LOG_INFO << "Replaying capture " << path.toStdString() << std::endl;
+    endConnectTrace("replay", 1);
+    emit connected(m_currentPortName);
+    updatePortMonitorState();
+}
+
+bool SerialPortConnectionManager::tryLastKnownPort()
+{
+    QSettings settings;
+    settings.beginGroup("serial");
+    const QString lastPort     = settings.value("lastPort").toString();
+    const QString serialNumber = settings.value("lastSerialNumber").toString();
+    const quint16 vendorId     = static_cast<quint16>(settings.value("lastVendorId", 0).toUInt());
+    const quint16 productId    = static_cast<quint16>(settings.value("lastProductId", 0).toUInt());
+    settings.endGroup();
+
+    if (lastPort.isEmpty())
     {
-        const QString portName = info.portName();
+        return false;
+    }
 
-        if (portName.startsWith("COM") || portName.startsWith("ttyUSB"))
+    // USB adapters may come back under another name, the serial number and VID/PID follow the device
+    QString portName;
+    for (const auto& info : QSerialPortInfo::availablePorts())
+    {
+        const bool sameDevice = !serialNumber.isEmpty() && info.serialNumber() == serialNumber &&
+                                info.vendorIdentifier() == vendorId && info.productIdentifier() == productId;
+        if (sameDevice)
+        {
+            portName = info.portName();
+            break;
+        }
+        if (info.portName() == lastPort)
         {
-            m_ports.append(info);
+            portName = lastPort;
         }
     }
 
 #ifdef Q_OS_LINUX
-    m_ports.append(QSerialPortInfo(testPort)); // for testing on Linux
+    if (portName.isEmpty() && lastPort == testPort)
+    {
+        portName = lastPort;
+    }
 #endif
 
-    m_currentPortIndex = -1;
+    if (portName.isEmpty())
+    {
+        LOG_INFO << "Last known port " << lastPort.toStdString() << " is not present" << std::endl;
+        return false;
+    }
+
+    LOG_INFO << "Trying last known port " << portName.toStdString() << std::endl;
+    Tracer::instance().instant(TraceTrack::Connection, "last known port");
+    m_state               = State::Probing;
+    m_tryingLastKnownPort = true;
+    openAndTestPort(portName, kLastKnownPortTimeoutMs);
+    return true;
+}
+
+void SerialPortConnectionManager::probePorts()
+{
+    m_tryingLastKnownPort = false;
+    stopProbes();
+    m_portModel->closePort();
+    m_currentPortName.clear();
+    m_waitingEchoReply = false;
+    m_portsAddedWhileProbing.clear();
+
+    const QStringList portNames = candidatePortNames();
 
     m_state = State::Probing;
 
-    LOG_INFO << "Probing " << m_ports.size() << " COM ports" << std::endl;
-    if (m_ports.isEmpty())
+    LOG_INFO << "Probing " << portNames.size() << " COM ports" << std::endl;
+    Tracer::instance().instant(TraceTrack::Connection, "probe ports", "ports", portNames.size());
+    if (portNames.isEmpty())
     {
         LOG_WRN << "No COM ports available" << std::endl;
         emit connectionError(tr("Нет доступных COM-портов"));
@@ -116,50 +259,169 @@ void SerialPortConnectionManager::probePorts()
         return;
     }
 
-    probeNextPort();
+    for (const QString& portName : portNames)
+    {
+        auto* probe = new PortProbe(portName, QSerialPort::Baud115200, this);
+        connect(probe, &PortProbe::echoReceived, this, &SerialPortConnectionManager::onProbeEchoReceived);
+
+        LOG_INFO << "Testing COM port " << portName.toStdString() << std::endl;
+        if (!probe->start())
+        {
+            probe->deleteLater();
+            continue;
+        }
+        m_probes.append(probe);
+    }
+
+    if (m_probes.isEmpty())
+    {
+        failProbing();
+        return;
+    }
+
+    // every port got its Echo at the same moment, one timeout covers all of them
+    armResponseTimer(m_responseTimeoutMs);
 }
 
-void SerialPortConnectionManager::probeNextPort()
+void SerialPortConnectionManager::stopProbes()
 {
+    for (PortProbe* probe : qAsConst(m_probes))
+    {
+        probe->disconnect(this);
+        probe->deleteLater();
+    }
+    m_probes.clear();
+}
+
+void SerialPortConnectionManager::failProbing()
+{
+    stopProbes();
     m_responseTimer.stop();
     m_waitingEchoReply = false;
-
     m_portModel->closePort();
     m_currentPortName.clear();
 
-    ++m_currentPortIndex;
-    if (m_currentPortIndex >= m_ports.size())
+    m_state = State::Disconnected;
+    endEchoTrace("timeout", 1);
+    endConnectTrace("failed", 1);
+    LOG_ERR << "Device not found on available COM ports" << std::endl;
+    emit connectionError(tr("Не удалось найти устройство"));
+    emit disconnected();
+    updatePortMonitorState();
+
+    // a port plugged in after the probe took its list was never tried
+    QSet<QString> missedPorts = m_portsAddedWhileProbing;
+    m_portsAddedWhileProbing.clear();
+    missedPorts.intersect(collectPortNames());
+    if (!missedPorts.isEmpty())
     {
-        m_state = State::Disconnected;
-        LOG_ERR << "Device not found on available COM ports" << std::endl;
-        emit connectionError(tr("Не удалось найти устройство"));
-        emit disconnected();
-        updatePortMonitorState();
+        LOG_INFO << "Serial port(s) appeared while probing, restarting auto-connect" << std::endl;
+        startAutoConnect();
+    }
+}
+
+void SerialPortConnectionManager::onProbeEchoReceived(const QString& portName)
+{
+    if (m_state != State::Probing || m_probes.isEmpty())
+    {
+        return;
+    }
+
+    LOG_INFO << "Device answered on COM port " << portName.toStdString() << std::endl;
+
+    // first answer wins, its port is already open and has answered, so it goes straight to the worker
+    std::unique_ptr<ITransport> transport;
+    uint8_t                     capabilities = 0;
+    for (PortProbe* probe : qAsConst(m_probes))
+    {
+        if (probe->portName() == portName)
+        {
+            transport    = probe->takeTransport();
+            capabilities = probe->capabilities();
+            break;
+        }
+    }
+
+    stopProbes();
+    m_responseTimer.stop();
+    if (!transport)
+    {
+        failProbing();
         return;
     }
 
-    const auto& info = m_ports[m_currentPortIndex];
-    openAndTestPort(info);
+    const int64_t adoptStartUs = monotonicUs();
+    const bool    adopted      = m_portModel->adoptTransport(std::move(transport), capabilities);
+    Tracer::instance().complete(TraceTrack::Connection, "adopt port", adoptStartUs, monotonicUs(), "opened", adopted);
+    if (!adopted)
+    {
+        LOG_WRN << "Failed to take over " << portName.toStdString() << std::endl;
+        failProbing();
+        return;
+    }
+
+    m_currentPortName = portName;
+    handleConnectSuccess();
 }
 
-void SerialPortConnectionManager::openAndTestPort(const QSerialPortInfo& info)
+void SerialPortConnectionManager::openAndTestPort(const QString& portName, int timeoutMs)
 {
-    const QString portName = (info.portName().isEmpty() ? testPort : info.portName());
-    LOG_INFO << "Testing COM port " << portName.toStdString() << std::endl;
-
-    if (!m_portModel->openPort(portName))
+    const int  baudRate = m_portOverride.portName.isEmpty() ? QSerialPort::Baud115200 : m_portOverride.baudRate;
+    const QUrl url(portName);
+    const int64_t openStartUs = monotonicUs();
+    const bool opened = url.scheme() == "tcp" ? m_portModel->openTcp(url.host(), static_cast<quint16>(url.port()))
+                                              : m_portModel->openPort(portName, baudRate);
+    Tracer::instance().complete(TraceTrack::Connection, "open port", openStartUs, monotonicUs(), "opened", opened);
+    if (!opened)
     {
-        LOG_WRN << "Failed to open COM port " << portName.toStdString() << ", trying next" << std::endl;
-        probeNextPort();
+        LOG_WRN << "Failed to open " << portName.toStdString() << std::endl;
+        if (m_tryingLastKnownPort)
+        {
+            probePorts();
+            return;
+        }
+        failProbing();
         return;
     }
 
     m_currentPortName = portName;
 
+    // the model repeats the Echo to learn the device capabilities
     m_waitingEchoReply = true;
     m_portModel->clearBuffer();
     m_portModel->sendCommand(Command::Echo);
-    m_responseTimer.start(m_responseTimeoutMs);
+    armResponseTimer(timeoutMs);
+    beginEchoTrace("first echo");
+}
+
+void SerialPortConnectionManager::rememberPort(const QString& portName) const
+{
+    QSettings settings;
+    settings.beginGroup("serial");
+    settings.setValue("lastPort", portName);
+    settings.remove("lastSerialNumber");
+    settings.remove("lastVendorId");
+    settings.remove("lastProductId");
+
+    for (const auto& info : QSerialPortInfo::availablePorts())
+    {
+        if (info.portName() != portName)
+        {
+            continue;
+        }
+
+        if (!info.serialNumber().isEmpty())
+        {
+            settings.setValue("lastSerialNumber", info.serialNumber());
+        }
+        if (info.hasVendorIdentifier() && info.hasProductIdentifier())
+        {
+            settings.setValue("lastVendorId", info.vendorIdentifier());
+            settings.setValue("lastProductId", info.productIdentifier());
+        }
+        break;
+    }
+    settings.endGroup();
 }
 
 void SerialPortConnectionManager::onEchoReceived()
@@ -172,6 +434,12 @@ void SerialPortConnectionManager::onEchoReceived()
     m_waitingEchoReply = false;
     m_responseTimer.stop();
 
+    if (m_state == State::Connected)
+    {
+        m_heartbeat.addSample(m_heartbeatSent.nsecsElapsed() / 1e6);
+    }
+    endEchoTrace(nullptr, 0);
+
     if (m_state == State::Probing)
     {
         handleConnectSuccess();
@@ -180,8 +448,17 @@ void SerialPortConnectionManager::onEchoReceived()
 
 void SerialPortConnectionManager::handleConnectSuccess()
 {
-    m_state = State::Connected;
+    m_state               = State::Connected;
+    m_tryingLastKnownPort = false;
+    m_portsAddedWhileProbing.clear();
+    ++m_connects;
+    if (m_portOverride.portName.isEmpty())
+    {
+        rememberPort(m_currentPortName);
+    }
+
     LOG_INFO << "Connected on port " << m_currentPortName.toStdString() << std::endl;
+    endConnectTrace("connects", static_cast<int64_t>(m_connects));
     emit connected(m_currentPortName);
 
     m_heartbeatTimer.start(m_heartbeatIntervalMs);
@@ -206,24 +483,56 @@ void SerialPortConnectionManager::onHeartbeatTimeout()
         return;
     }
 
-    LOG_INFO << "Sending heartbeat echo" << std::endl;
+    LOG_INFO << "Sending heartbeat echo, srtt=" << m_portModel->smoothedRttMs()
+             << " ms rttvar=" << m_portModel->rttVarianceMs() << " ms ack timeout=" << m_portModel->ackTimeoutMs()
+             << " ms delay=" << m_portModel->commandDelayMs() << " ms" << std::endl;
+
+    const auto interactive = m_portModel->laneStats(SerialPortModel::Lane::Interactive);
+    const auto bulk        = m_portModel->laneStats(SerialPortModel::Lane::Bulk);
+    LOG_INFO << "Queue lanes: interactive sent=" << interactive.sent << " max wait=" << interactive.maxWaitUs
+             << " us, bulk sent=" << bulk.sent << " depth=" << bulk.depth << " max depth=" << bulk.maxDepth
+             << " max wait=" << bulk.maxWaitUs << " us, coalesced=" << m_portModel->coalescedFrames() << std::endl;
     m_waitingEchoReply = true;
+    m_heartbeatSent.start();
+    ++m_heartbeat.sent;
     m_portModel->sendCommand(Command::Echo);
-    m_responseTimer.start(m_responseTimeoutMs);
+    armResponseTimer(m_responseTimeoutMs);
+    beginEchoTrace("heartbeat");
 }
 
 void SerialPortConnectionManager::onResponseTimeout()
 {
+    // the Echo may be answered and waiting behind the stall, judge only a period the loop ran through
+    if (m_watchdog && m_responseDeferrals < kMaxResponseDeferrals && m_watchdog->stalledSince(m_responseArmedUs))
+    {
+        ++m_responseDeferrals;
+        ++m_deferredTimeouts;
+        LOG_WRN << "Response timeout covers a GUI event loop stall, waiting one more period" << std::endl;
+        m_responseArmedUs = monotonicUs();
+        m_responseTimer.start();
+        return;
+    }
+
+    endEchoTrace("timeout", 1);
+
     if (m_state == State::Probing)
     {
+        if (m_tryingLastKnownPort)
+        {
+            LOG_INFO << "Last known port did not answer, probing all ports" << std::endl;
+            probePorts();
+            return;
+        }
+
         LOG_WRN << "Response timeout while probing" << std::endl;
-        probeNextPort();
+        failProbing();
         return;
     }
 
     if (m_state == State::Connected)
     {
         LOG_WRN << "Response timeout while connected, restarting auto-connect" << std::endl;
+        ++m_heartbeat.missed;
         handleDisconnect(/*restartAutoConnect=*/true);
     }
 }
@@ -237,6 +546,10 @@ void SerialPortConnectionManager::handleDisconnect(bool restartAutoConnect)
     if (m_state == State::Connected)
     {
         LOG_INFO << "Disconnected from port " << m_currentPortName.toStdString() << std::endl;
+        if (restartAutoConnect)
+        {
+            ++m_reconnects;
+        }
         emit disconnected();
     }
 
@@ -263,6 +576,12 @@ void SerialPortConnectionManager::monitorAvailablePorts()
 
     m_lastObservedPorts = currentPorts;
 
+    if (m_state == State::Probing)
+    {
+        m_portsAddedWhileProbing.unite(newPorts);
+        return;
+    }
+
     if (!newPorts.isEmpty() && m_state == State::Disconnected)
     {
         LOG_INFO << "Detected new serial port(s), starting auto-connect" << std::endl;
@@ -270,9 +589,32 @@ void SerialPortConnectionManager::monitorAvailablePorts()
     }
 }
 
+void SerialPortConnectionManager::onHotplugSettled()
+{
+    if (m_state == State::Connected && !m_portOverride.replayFile.isEmpty())
+    {
+        return;
+    }
+
+    if (m_state == State::Connected)
+    {
+        // a removed adapter is noticed right away instead of after the heartbeat timeout
+        m_lastObservedPorts   = collectPortNames();
+        const bool serialPort = m_currentPortName != testPort && !m_currentPortName.startsWith("tcp://");
+        if (serialPort && !portNodeExists(m_currentPortName))
+        {
+            LOG_WRN << "Port " << m_currentPortName.toStdString() << " was removed" << std::endl;
+            handleDisconnect(/*restartAutoConnect=*/true);
+        }
+        return;
+    }
+
+    monitorAvailablePorts();
+}
+
 void SerialPortConnectionManager::updatePortMonitorState()
 {
-    const bool shouldMonitor = (m_state == State::Disconnected);
+    const bool shouldMonitor = (m_state == State::Disconnected) && !m_hotplugWatcher.isActive();
     if (shouldMonitor)
     {
         if (!m_portMonitorTimer.isActive())
@@ -289,6 +631,66 @@ void SerialPortConnectionManager::updatePortMonitorState()
     }
 }
 
+void SerialPortConnectionManager::armResponseTimer(int timeoutMs)
+{
+    m_responseArmedUs   = monotonicUs();
+    m_responseDeferrals = 0;
+    m_responseTimer.start(timeoutMs);
+}
+
+void SerialPortConnectionManager::beginEchoTrace(const char* name)
+{
+    Tracer& tracer = Tracer::instance();
+    if (!tracer.isEnabled())
+    {
+        return;
+    }
+
+    endEchoTrace("superseded", 1);
+    m_echoTraceId   = tracer.nextId();
+    m_echoTraceName = name;
+    tracer.asyncBegin(TraceTrack::Connection, name, m_echoTraceId);
+}
+
+void SerialPortConnectionManager::endEchoTrace(const char* argName, int64_t arg)
+{
+    if (m_echoTraceId != 0)
+    {
+        Tracer::instance().asyncEnd(TraceTrack::Connection, m_echoTraceName, m_echoTraceId, argName, arg);
+        m_echoTraceId = 0;
+    }
+}
+
+void SerialPortConnectionManager::endConnectTrace(const char* argName, int64_t arg)
+{
+    if (m_connectTraceId != 0)
+    {
+        Tracer::instance().asyncEnd(TraceTrack::Connection, "auto-connect", m_connectTraceId, argName, arg);
+        m_connectTraceId = 0;
+    }
+}
+
+QStringList SerialPortConnectionManager::candidatePortNames() const
+{
+    QStringList portNames;
+
+    for (const auto& info : QSerialPortInfo::availablePorts())
+    {
+        const QString portName = info.portName();
+
+        if (portName.startsWith("COM") || portName.startsWith("ttyUSB"))
+        {
+            portNames.append(portName);
+        }
+    }
+
+#ifdef Q_OS_LINUX
+    portNames.append(testPort); // for testing on Linux
+#endif
+
+    return portNames;
+}
+
 QSet<QString> SerialPortConnectionManager::collectPortNames() const
 {
     QSet<QString> ports;
@@ -305,3 +707,14 @@ QSet<QString> SerialPortConnectionManager::collectPortNames() const
 
     return ports;
 }
+
+bool SerialPortConnectionManager::portNodeExists(const QString& portName) const
+{
+    // --port also takes paths and names the candidate filter skips, e.g. /dev/serial/by-id/... or ttyACM0
+#ifdef Q_OS_UNIX
+    const QString location = portName.startsWith(QLatin1Char('/')) ? portName : QStringLiteral("/dev/") + portName;
+    return QFileInfo::exists(location);
+#else
+    return !QSerialPortInfo(portName).isNull();
+#endif
+}
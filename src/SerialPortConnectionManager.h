@@ -1,10 +1,16 @@
 #pragma once
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QSerialPortInfo>
 #include <QSet>
+#include <QStringList>
 #include <QTimer>
 
+#include "EventLoopWatchdog.h"
+#include "LinkDiagnostics.h"
+#include "PortHotplugWatcher.h"
+#include "PortProbe.h"
 #include "SerialPortModel.h"
 
 class SerialPortConnectionManager : public QObject
@@ -19,8 +25,22 @@ class SerialPortConnectionManager : public QObject
     };
 
 public:
+    // Port given on the command line, probing is skipped when set.
+    // tcp://host:port connects to a socket instead of a serial port.
+    struct PortOverride
+    {
+        QString portName{};
+        int     baudRate{QSerialPort::Baud115200};
+
+        // Plays a wire capture instead of opening a port
+        QString                replayFile{};
+        ReplayTransport::Speed replaySpeed{ReplayTransport::Speed::Original};
+    };
+
     explicit SerialPortConnectionManager(SerialPortModel* portModel, QObject* parent = nullptr);
 
+    void setPortOverride(const PortOverride& portOverride);
+
     void startAutoConnect();
     void stopAutoConnect();
 
@@ -29,6 +49,12 @@ public:
 
     void setHeartbeatInterval(int ms);
 
+    // Response timeouts that cover a GUI stall are postponed instead of judged, optional
+    void setEventLoopWatchdog(const EventLoopWatchdog* watchdog);
+
+    // Counters of the model and the heartbeat statistics of this manager
+    LinkDiagnostics diagnostics() const;
+
     bool sendCommand(Command cmd);
 
 signals:
@@ -42,35 +68,81 @@ private slots:
     void onHeartbeatTimeout();
     void onResponseTimeout();
     void monitorAvailablePorts();
+    void onHotplugSettled();
+    void onProbeEchoReceived(const QString& portName);
 
 private:
+    void startReplay();
     void probePorts();
-    void probeNextPort();
-    void openAndTestPort(const QSerialPortInfo& info);
+    bool tryLastKnownPort();
+    void stopProbes();
+    void failProbing();
+    void openAndTestPort(const QString& portName, int timeoutMs);
+    void rememberPort(const QString& portName) const;
     void handleConnectSuccess();
     void handleDisconnect(bool restartAutoConnect = true);
     void updatePortMonitorState();
+    void armResponseTimer(int timeoutMs);
+
+    void beginEchoTrace(const char* name);
+    void endEchoTrace(const char* argName, int64_t arg);
+    void endConnectTrace(const char* argName, int64_t arg);
 
     QSet<QString> collectPortNames() const;
+    QStringList   candidatePortNames() const;
+    bool          portNodeExists(const QString& portName) const;
 
     SerialPortModel* m_portModel{nullptr};
 
     State m_state{State::Disconnected};
 
-    QList<QSerialPortInfo> m_ports{};
-
-    int m_currentPortIndex{-1};
+    // One probe per candidate port, all waiting for an Echo at the same time
+    QList<PortProbe*> m_probes{};
 
     QTimer m_heartbeatTimer{};
     QTimer m_responseTimer{};
     QTimer m_portMonitorTimer{};
 
+    // Event driven port detection, m_portMonitorTimer only polls when it is not available
+    PortHotplugWatcher m_hotplugWatcher{};
+    QTimer             m_hotplugSettleTimer{};
+
     int  m_heartbeatIntervalMs{5000};
     int  m_responseTimeoutMs{1000};
     bool m_waitingEchoReply{false};
 
+    const EventLoopWatchdog* m_watchdog{nullptr};
+    int64_t                  m_responseArmedUs{0};
+    int                      m_responseDeferrals{0}; // of the current Echo
+    quint64                  m_deferredTimeouts{0};
+
+    QElapsedTimer  m_heartbeatSent{};
+    HeartbeatStats m_heartbeat{};
+    quint64        m_connects{0};
+    quint64        m_reconnects{0};
+
+    // Open async spans while tracing, 0 when none
+    uint64_t    m_connectTraceId{0};
+    uint64_t    m_echoTraceId{0};
+    const char* m_echoTraceName{nullptr};
+
+    PortOverride m_portOverride{};
+
+    // Set while the last known good port is tried before the full probe
+    bool m_tryingLastKnownPort{false};
+
     QString       m_currentPortName{};
     QSet<QString> m_lastObservedPorts{};
+    QSet<QString> m_portsAddedWhileProbing{}; // missed by the running probe, retried when it fails
 
     static constexpr auto testPort{"/tmp/ttyV1"};
+
+    // The remembered device answers within one round-trip, anything longer means a full probe
+    static constexpr int kLastKnownPortTimeoutMs = 250;
+
+    // Groups the burst of inotify events of one plug-in and gives udev time to set permissions
+    static constexpr int kHotplugSettleMs = 50;
+
+    // A loop that keeps stalling still gets its timeout judged after this many extra periods
+    static constexpr int kMaxResponseDeferrals = 3;
 };
@@ -1,274 +1,280 @@
 #include "SerialPortModel.h"
 
-#include "logger.h"
+#include <QMetaObject>
 
-SerialPortModel::SerialPortModel(QObject* parent) : QObject(parent), m_serial(new QSerialPort(this))
+#include "SerialTransport.h"
+#include "TcpTransport.h"
+
+template <typename Func>
+void SerialPortModel::invokeOnWorker(Func&& func)
+{
+    QMetaObject::invokeMethod(m_worker, std::forward<Func>(func), Qt::QueuedConnection);
+}
+
+template <typename Func>
+void SerialPortModel::invokeOnWorkerBlocking(Func&& func)
 {
-    connect(m_serial, &QSerialPort::readyRead, this, &SerialPortModel::handleReadyRead);
-    connect(m_serial, &QSerialPort::errorOccurred, this, &SerialPortModel::handleError);
+    QMetaObject::invokeMethod(m_worker, std::forward<Func>(func), Qt::BlockingQueuedConnection);
+}
+
+SerialPortModel::SerialPortModel(QObject* parent) : QObject(parent)
+{
+    m_events = std::make_unique<SerialEventChannel>(
+        [this]() { QMetaObject::invokeMethod(this, &SerialPortModel::drainEvents, Qt::QueuedConnection); });
+
+    m_worker = new SerialPortWorker(m_events.get());
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
 
-    m_commandDelayTimer.setSingleShot(true);
-    connect(&m_commandDelayTimer, &QTimer::timeout, this, &SerialPortModel::handleQueueDelayTimeout);
+    m_thread.setObjectName("SerialIO");
+    m_thread.start();
 
-    m_ackTimeoutTimer.setSingleShot(true);
-    connect(&m_ackTimeoutTimer, &QTimer::timeout, this, &SerialPortModel::handleAckTimeout);
+    invokeOnWorkerBlocking([this]() { m_link = m_worker->linkState(); });
 }
 
 SerialPortModel::~SerialPortModel()
 {
     closePort();
+
+    // the worker is deleted on its own thread once the event loop is gone
+    m_thread.quit();
+    m_thread.wait();
 }
 
-bool SerialPortModel::openPort(const QString& portName, int baudRate)
+bool SerialPortModel::openTransport(const TransportFactory& factory)
 {
-    if (m_serial->isOpen())
-    {
-        closePort();
-    }
+    bool      opened = false;
+    LinkState state;
+    invokeOnWorkerBlocking(
+        [this, &opened, &state, &factory]()
+        {
+            opened = m_worker->openTransport(factory());
+            state  = m_worker->linkState();
+        });
 
-    m_serial->setPortName(portName);
-    LOG_INFO << "Opening COM port " << portName.toStdString() << " at " << baudRate << " baud" << std::endl;
-    m_serial->setBaudRate(baudRate);
-    m_serial->setDataBits(QSerialPort::Data8);
-    m_serial->setParity(QSerialPort::NoParity);
-    m_serial->setStopBits(QSerialPort::OneStop);
-    m_serial->setFlowControl(QSerialPort::NoFlowControl);
-    const bool opened = m_serial->open(QIODevice::ReadWrite);
-    if (!opened)
-    {
-        LOG_ERR << "Failed to open port " << portName.toStdString() << ": " << m_serial->errorString().toStdString()
-                << std::endl;
-    }
-    else
-    {
-        LOG_INFO << "Port " << portName.toStdString() << " opened successfully" << std::endl;
-        processQueue();
-    }
+    applyLinkState(state);
     return opened;
 }
 
-void SerialPortModel::closePort()
+bool SerialPortModel::adoptTransport(std::unique_ptr<ITransport> transport, uint8_t capabilities)
 {
-    if (m_serial->isOpen())
-    {
-        LOG_INFO << "Closing COM port " << m_serial->portName().toStdString() << std::endl;
-        m_serial->close();
-        clearCommandQueue();
-    }
+    // moveToThread() has to run on the thread the transport belongs to now
+    transport->setParent(nullptr);
+    transport->moveToThread(&m_thread);
+
+    bool      opened = false;
+    LinkState state;
+    invokeOnWorkerBlocking(
+        [this, &opened, &state, &transport, capabilities]()
+        {
+            opened = m_worker->openTransport(std::move(transport), capabilities);
+            state  = m_worker->linkState();
+        });
+
+    applyLinkState(state);
+    return opened;
 }
 
-void SerialPortModel::clearBuffer()
+void SerialPortModel::closePort()
 {
-    m_buffer.append(m_serial->readAll());
-    m_buffer.clear();
+    LinkState state;
+    invokeOnWorkerBlocking(
+        [this, &state]()
+        {
+            m_worker->closePort();
+            state = m_worker->linkState();
+        });
+
+    applyLinkState(state);
 }
 
-void SerialPortModel::sendCommand(Command command, Pins pins)
+bool SerialPortModel::openPort(const QString& portName, int baudRate)
 {
-    enqueueCommand(command, pins);
+    return openTransport([&portName, baudRate]() { return std::make_unique<SerialTransport>(portName, baudRate); });
 }
 
-void SerialPortModel::sendCommand(Command command)
+bool SerialPortModel::openTcp(const QString& host, quint16 port)
 {
-    enqueueCommand(command);
+    return openTransport([&host, port]() { return std::make_unique<TcpTransport>(host, port); });
 }
 
-void SerialPortModel::handleReadyRead()
+bool SerialPortModel::openReplay(const QString& path, ReplayTransport::Speed speed)
 {
-    m_buffer.append(m_serial->readAll());
-    processBuffer();
+    return openTransport([&path, speed]() { return std::make_unique<ReplayTransport>(path, speed); });
 }
 
-void SerialPortModel::handleError(QSerialPort::SerialPortError error)
+bool SerialPortModel::startCapture(const QString& path)
 {
-    if (error == QSerialPort::NoError)
-    {
-        return;
-    }
-
-    LOG_ERR << "Serial port error: " << m_serial->errorString().toStdString() << std::endl;
-    emit portError(m_serial->errorString());
+    bool started = false;
+    invokeOnWorkerBlocking([this, &started, &path]() { started = m_worker->startCapture(path); });
+    return started;
 }
 
-void SerialPortModel::processBuffer()
+void SerialPortModel::stopCapture()
 {
-    // find SOF
-    while (m_buffer.size() >= 3)
-    {
-        if (static_cast<uint8_t>(m_buffer.at(0)) != PROTOCOL_SOF)
-        {
-            m_buffer.remove(0, 1);
-            continue;
-        }
-        uint8_t len = static_cast<uint8_t>(m_buffer.at(1));
-        if (m_buffer.size() < len + 2) // wait for full packet
-        {
-            return;
-        }
-        QByteArray frame = m_buffer.mid(0, len + 2);
-        m_buffer.remove(0, len + 2);
-
-        uint8_t cs = calc_checksum(reinterpret_cast<const uint8_t*>(frame.constData()), len + 1);
-        if (cs != static_cast<uint8_t>(frame.at(len + 1)))
-        {
-            continue;
-        }
+    invokeOnWorker([worker = m_worker]() { worker->stopCapture(); });
+}
 
-        parsePacket(frame);
-    }
+void SerialPortModel::clearBuffer()
+{
+    invokeOnWorker([worker = m_worker]() { worker->clearBuffer(); });
 }
 
-void SerialPortModel::parsePacket(QByteArray& frame)
+void SerialPortModel::setSendWindow(int window)
 {
-    const Packet* rp = reinterpret_cast<const Packet*>(frame.constData());
+    m_sendWindow = window;
+    invokeOnWorker([worker = m_worker, window]() { worker->setSendWindow(window); });
+}
 
-    if (rp->command == Command::Echo)
-    {
-        handleCommandAck(Command::Echo);
-        emit echoReceived();
-        return;
-    }
+int SerialPortModel::sendWindow() const
+{
+    return m_sendWindow;
+}
 
-    if (rp->command == Command::StatusUpdate)
-    {
-        const StatusPayload* status = reinterpret_cast<const StatusPayload*>(rp->payload);
+uint8_t SerialPortModel::deviceCapabilities() const
+{
+    return m_link.capabilities;
+}
 
-        QVector<Pins> leds;
-        leds.reserve(status->leds_num);
-        for (int i = 0; i < status->leds_num; ++i)
-        {
-            leds.append(status->leds[i]);
-        }
-        emit statusReceived(status->pins, leds);
-        return;
-    }
+bool SerialPortModel::supportsCapability(uint8_t capability) const
+{
+    return (m_link.capabilities & capability) == capability;
+}
 
-    handleCommandAck(rp->command);
-    emit receivedCommand(rp->command);
+void SerialPortModel::setTimingBounds(const TimingBounds& bounds)
+{
+    m_bounds = bounds;
+    invokeOnWorker([worker = m_worker, bounds]() { worker->setTimingBounds(bounds); });
 }
 
-void SerialPortModel::enqueueCommand(Command command, Pins pins)
+SerialPortModel::TimingBounds SerialPortModel::timingBounds() const
 {
-    m_commandQueue.enqueue({command, build_packet_for_cmd(command, pins)});
-    processQueue();
+    return m_bounds;
 }
 
-void SerialPortModel::enqueueCommand(Command command)
+void SerialPortModel::setRetryPolicy(const RetryPolicy& policy)
 {
-    m_commandQueue.enqueue({command, build_packet_for_cmd(command)});
-    processQueue();
+    m_retryPolicy = policy;
+    invokeOnWorker([worker = m_worker, policy]() { worker->setRetryPolicy(policy); });
 }
 
-void SerialPortModel::processQueue()
+SerialPortModel::RetryPolicy SerialPortModel::retryPolicy() const
 {
-    if (!m_serial || !m_serial->isOpen())
-    {
-        return;
-    }
+    return m_retryPolicy;
+}
 
-    if (m_waitingForAck)
-    {
-        return;
-    }
+SerialPortModel::LaneStats SerialPortModel::laneStats(Lane lane) const
+{
+    return m_worker->laneStats(lane);
+}
 
-    if (m_commandDelayTimer.isActive())
-    {
-        return;
-    }
+void SerialPortModel::resetLaneStats()
+{
+    invokeOnWorker([worker = m_worker]() { worker->resetLaneStats(); });
+}
 
-    while (!m_commandQueue.isEmpty())
-    {
-        const QueuedCommand cmd = m_commandQueue.dequeue();
+SerialPortModel::LinkStats SerialPortModel::linkStats() const
+{
+    return m_worker->linkStats();
+}
 
-        const std::vector<uint8_t>& packet = cmd.payload;
+quint64 SerialPortModel::coalescedFrames() const
+{
+    return m_worker->coalescedFrames();
+}
 
-        m_serial->write(reinterpret_cast<const char*>(packet.data()), packet.size());
+SerialPortModel::Lane SerialPortModel::laneFor(Command command)
+{
+    return SerialPortWorker::laneFor(command);
+}
 
-        if (requiresAcknowledgement(cmd.command))
-        {
-            m_waitingForAck = true;
-            m_expectedAck   = cmd.command;
-            m_ackTimeoutTimer.start(kAckTimeoutMs);
-            break;
-        }
+double SerialPortModel::smoothedRttMs() const
+{
+    return m_link.smoothedRttMs;
+}
 
-        if (kInterCommandDelayMs > 0)
-        {
-            m_commandDelayTimer.start(kInterCommandDelayMs);
-            break;
-        }
-    }
+double SerialPortModel::rttVarianceMs() const
+{
+    return m_link.rttVarianceMs;
 }
 
-void SerialPortModel::handleCommandAck(Command command)
+int SerialPortModel::ackTimeoutMs() const
 {
-    if (!m_waitingForAck)
-    {
-        return;
-    }
+    return m_link.ackTimeoutMs;
+}
 
-    if (command != m_expectedAck)
-    {
-        return;
-    }
+int SerialPortModel::commandDelayMs() const
+{
+    return m_link.commandDelayMs;
+}
 
-    m_waitingForAck = false;
-    m_expectedAck   = Command::None;
-    m_ackTimeoutTimer.stop();
+void SerialPortModel::sendCommand(Command command, Pins pins)
+{
+    invokeOnWorker([worker = m_worker, command, pins]() { worker->sendCommand(command, pins); });
+}
 
-    if (kInterCommandDelayMs > 0)
-    {
-        m_commandDelayTimer.start(kInterCommandDelayMs);
-        return;
-    }
+void SerialPortModel::sendCommand(Command command)
+{
+    invokeOnWorker([worker = m_worker, command]() { worker->sendCommand(command); });
+}
 
-    processQueue();
+void SerialPortModel::sendDiodeConfigBatch(const QVector<Pins>& diodes)
+{
+    invokeOnWorker([worker = m_worker, diodes]() { worker->sendDiodeConfigBatch(diodes); });
 }
 
-void SerialPortModel::handleQueueDelayTimeout()
+void SerialPortModel::drainEvents()
 {
-    processQueue();
+    m_events->drain([this](const SerialEvent& event) { handleEvent(event); });
 }
 
-void SerialPortModel::handleAckTimeout()
+void SerialPortModel::handleEvent(const SerialEvent& event)
 {
-    if (!m_waitingForAck)
+    // left over from a port that has been closed or reopened since
+    if (event.generation != m_link.generation)
     {
         return;
     }
 
-    LOG_WRN << "Ack timeout for command " << static_cast<int>(m_expectedAck) << std::endl;
-    m_waitingForAck = false;
-    m_expectedAck   = Command::None;
-
-    if (kInterCommandDelayMs > 0)
+    switch (event.type)
     {
-        m_commandDelayTimer.start(kInterCommandDelayMs);
-        return;
+        case SerialEvent::Type::Status:
+            emit statusReceived(event.pins, event.leds, event.timestampUs);
+            break;
+        case SerialEvent::Type::CommandReceived:
+            emit receivedCommand(event.command);
+            break;
+        case SerialEvent::Type::Echo:
+            emit echoReceived();
+            break;
+        case SerialEvent::Type::LinkStateChanged:
+            applyLinkState(event.link);
+            break;
+        case SerialEvent::Type::CommandFailed:
+            emit commandFailed(event.command, event.pins);
+            break;
+        case SerialEvent::Type::PortError:
+            emit portError(event.error);
+            break;
+        case SerialEvent::Type::DiodeDigest:
+            emit diodeDigestReceived(event.diodeCount, event.diodeDigest);
+            break;
     }
-
-    processQueue();
 }
 
-void SerialPortModel::clearCommandQueue()
+void SerialPortModel::applyLinkState(const LinkState& state)
 {
-    m_commandQueue.clear();
-    m_commandDelayTimer.stop();
-    m_ackTimeoutTimer.stop();
-    m_waitingForAck = false;
-    m_expectedAck   = Command::None;
-}
+    const LinkState previous = m_link;
+    m_link                   = state;
 
-bool SerialPortModel::requiresAcknowledgement(Command command)
-{
-    switch (command)
+    if (state.capabilities != previous.capabilities)
+    {
+        emit deviceCapabilitiesChanged(state.capabilities);
+    }
+
+    if (state.smoothedRttMs != previous.smoothedRttMs || state.rttVarianceMs != previous.rttVarianceMs ||
+        state.ackTimeoutMs != previous.ackTimeoutMs || state.commandDelayMs != previous.commandDelayMs)
     {
-        case Command::Echo:
-        case Command::ModeDiodeConfig:
-        case Command::ModeDiodeConfigDel:
-        case Command::ModeDiodeClear:
-            return true;
-        default:
-            return false;
+        emit rttEstimateChanged();
     }
 }
@@ -1,78 +1,143 @@
 #pragma once
 
-#include <QByteArray>
 #include <QObject>
-#include <QQueue>
 #include <QSerialPort>
-#include <QTimer>
+#include <QThread>
 #include <QVector>
+#include <functional>
+#include <memory>
 
+#include "ITransport.h"
 #include "KeyboardControllerProtocol.h"
-
-class MainWindow;
-
+#include "ReplayTransport.h"
+#include "SerialEvent.h"
+#include "SerialPortWorker.h"
+
+// GUI-thread facade of SerialPortWorker.
+// Port I/O, frame parsing and the command queue run on a dedicated thread, so a busy GUI
+// no longer delays reads or ACK timers. Decoded events come back through a lock-free
+// channel and are re-emitted here as signals.
 class SerialPortModel : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(double smoothedRttMs READ smoothedRttMs NOTIFY rttEstimateChanged)
+    Q_PROPERTY(double rttVarianceMs READ rttVarianceMs NOTIFY rttEstimateChanged)
+    Q_PROPERTY(int ackTimeoutMs READ ackTimeoutMs NOTIFY rttEstimateChanged)
+    Q_PROPERTY(int commandDelayMs READ commandDelayMs NOTIFY rttEstimateChanged)
+
 public:
+    using TimingBounds = SerialPortWorker::TimingBounds;
+    using Lane         = SerialPortWorker::Lane;
+    using LaneStats    = SerialPortWorker::LaneStats;
+    using LinkStats    = SerialPortWorker::LinkStats;
+    using RetryPolicy  = SerialPortWorker::RetryPolicy;
+
+    // Runs on the I/O thread, so the transport is created with the right thread affinity
+    using TransportFactory = std::function<std::unique_ptr<ITransport>()>;
+
     explicit SerialPortModel(QObject* parent = nullptr);
     ~SerialPortModel();
 
-    bool openPort(const QString& portName, int baudRate = QSerialPort::Baud115200);
+    // Blocks until the I/O thread has opened/closed the transport
+    bool openTransport(const TransportFactory& factory);
     void closePort();
 
+    // Moves a transport opened on this thread to the I/O thread, e.g. the port a probe found the device
+    // on. capabilities are the ones that probe's Echo reported.
+    bool adoptTransport(std::unique_ptr<ITransport> transport, uint8_t capabilities);
+
+    bool openPort(const QString& portName, int baudRate = QSerialPort::Baud115200);
+    bool openTcp(const QString& host, quint16 port);
+
+    // The capture stands in for the port until closePort()
+    bool openReplay(const QString& path, ReplayTransport::Speed speed = ReplayTransport::Speed::Original);
+
+    bool startCapture(const QString& path);
+    void stopCapture();
+
     void clearBuffer();
 
+    // Maximum number of acknowledged commands in flight when the device supports sequencing
+    void setSendWindow(int window);
+    int  sendWindow() const;
+
+    uint8_t deviceCapabilities() const;
+    bool    supportsCapability(uint8_t capability) const;
+
+    void         setTimingBounds(const TimingBounds& bounds);
+    TimingBounds timingBounds() const;
+
+    void        setRetryPolicy(const RetryPolicy& policy);
+    RetryPolicy retryPolicy() const;
+
+    LaneStats laneStats(Lane lane) const;
+    void      resetLaneStats();
+
+    // Frame, byte, error and retry counters of the I/O thread, safe to poll at any rate
+    LinkStats linkStats() const;
+
+    // Frames that were never written because a later pending command superseded them
+    quint64 coalescedFrames() const;
+
+    static Lane laneFor(Command command);
+
+    // Live link estimates, zero until the first ACK has been measured
+    double smoothedRttMs() const;
+    double rttVarianceMs() const;
+
+    // Currently applied values derived from the estimates
+    int ackTimeoutMs() const;
+    int commandDelayMs() const;
+
 public:
     void sendCommand(Command command, Pins pins);
     void sendCommand(Command command);
 
+    // Queues ModeDiodeConfigBatch frames, split so each fits Packet::length
+    void sendDiodeConfigBatch(const QVector<Pins>& diodes);
+
 signals:
-    void statusReceived(Pins pins, const QVector<Pins>& leds);
+    // receivedUs is the monotonicUs() of the decode on the I/O thread
+    void statusReceived(Pins pins, const LedList& leds, qint64 receivedUs);
 
     void receivedCommand(Command command);
 
     void echoReceived();
 
-    void portError(const QString& description);
+    void deviceCapabilitiesChanged(uint8_t capabilities);
 
-private slots:
-    void handleReadyRead();
+    void rttEstimateChanged();
 
-    void handleError(QSerialPort::SerialPortError error);
+    // An acknowledged command was not confirmed after all retries
+    void commandFailed(Command command, Pins pins);
 
-private:
-    void processBuffer();
+    // Reply to Command::DiodeDigest
+    void diodeDigestReceived(int count, quint32 digest);
 
-    void parsePacket(QByteArray& frame);
+    void portError(const QString& description);
 
-    void enqueueCommand(Command command, Pins pins);
-    void enqueueCommand(Command command);
-    void processQueue();
-    void handleCommandAck(Command command);
-    void handleQueueDelayTimeout();
-    void handleAckTimeout();
-    void clearCommandQueue();
+private slots:
+    void drainEvents();
 
-    static bool requiresAcknowledgement(Command command);
+private:
+    void handleEvent(const SerialEvent& event);
 
-    struct QueuedCommand
-    {
-        Command command{Command::None};
+    void applyLinkState(const LinkState& state);
 
-        std::vector<uint8_t> payload;
-    };
+    template <typename Func>
+    void invokeOnWorker(Func&& func);
 
-    QSerialPort* m_serial;
-    QByteArray   m_buffer;
+    template <typename Func>
+    void invokeOnWorkerBlocking(Func&& func);
 
-    QQueue<QueuedCommand> m_commandQueue;
+    std::unique_ptr<SerialEventChannel> m_events;
 
-    QTimer  m_commandDelayTimer;
-    QTimer  m_ackTimeoutTimer;
-    bool    m_waitingForAck{false};
-    Command m_expectedAck{Command::None};
+    QThread           m_thread;
+    SerialPortWorker* m_worker{nullptr};
 
-    static constexpr int kInterCommandDelayMs = 5;
-    static constexpr int kAckTimeoutMs        = 200;
+    // Mirrors of the worker state for the const getters
+    LinkState    m_link{};
+    int          m_sendWindow{8};
+    TimingBounds m_bounds{};
+    RetryPolicy  m_retryPolicy{};
 };
@@ -0,0 +1,991 @@
+#include "SerialPortWorker.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "MonotonicClock.h"
+#include "Tracer.h"
+#include "logger.h"
+
+SerialPortWorker::SerialPortWorker(SerialEventChannel* events, QObject* parent)
+    : QObject(parent),
+      m_events(events),
+      m_commandDelayTimer(this),
+      m_ackTimeoutTimer(this),
+      m_backlogTimer(this)
+{
+    m_commandDelayTimer.setSingleShot(true);
+    m_commandDelayTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_commandDelayTimer, &QTimer::timeout, this, &SerialPortWorker::handleQueueDelayTimeout);
+
+    m_ackTimeoutTimer.setSingleShot(true);
+    m_ackTimeoutTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_ackTimeoutTimer, &QTimer::timeout, this, &SerialPortWorker::handleAckTimeout);
+
+    m_backlogTimer.setSingleShot(true);
+    connect(&m_backlogTimer, &QTimer::timeout, this, &SerialPortWorker::flushBacklog);
+
+    m_clock.start();
+}
+
+SerialPortWorker::~SerialPortWorker()
+{
+    closePort();
+}
+
+bool SerialPortWorker::openTransport(std::unique_ptr<ITransport> transport, uint8_t capabilities)
+{
+    closePort();
+
+    ++m_generation;
+    m_transport = std::move(transport);
+    connect(m_transport.get(), &ITransport::readyRead, this, &SerialPortWorker::handleReadyRead);
+    connect(m_transport.get(), &ITransport::errorOccurred, this, &SerialPortWorker::handleError);
+
+    const std::string description = m_transport->description().toStdString();
+    LOG_INFO << "Opening " << description << std::endl;
+    if (!m_transport->open())
+    {
+        LOG_ERR << "Failed to open " << description << ": " << m_transport->errorString().toStdString()
+                << std::endl;
+        return false;
+    }
+
+    LOG_INFO << "Opened " << description << " successfully" << std::endl;
+    if (capabilities != 0)
+    {
+        LOG_INFO << "Device capabilities 0x" << std::hex << static_cast<int>(capabilities) << std::dec << std::endl;
+        m_deviceCapabilities = capabilities;
+        publishLinkState();
+    }
+    processQueue();
+    return true;
+}
+
+void SerialPortWorker::closePort()
+{
+    if (isTransportOpen())
+    {
+        LOG_INFO << "Closing " << m_transport->description().toStdString() << std::endl;
+        m_transport->close();
+        clearCommandQueue();
+        ++m_generation;
+    }
+    m_transport.reset();
+
+    // events of the closed session are dropped by the consumer
+    m_backlog.clear();
+    m_backlogTimer.stop();
+
+    const bool linkChanged = m_deviceCapabilities != 0 || m_hasRttSample;
+
+    m_deviceCapabilities = 0;
+    if (m_hasRttSample)
+    {
+        // the next device may sit behind a different adapter
+        m_hasRttSample = false;
+        m_srttUs       = 0;
+        m_rttVarUs     = 0;
+        updateDerivedTimings();
+    }
+    else if (linkChanged)
+    {
+        publishLinkState();
+    }
+}
+
+bool SerialPortWorker::startCapture(const QString& path)
+{
+    if (!m_capture.open(path.toStdString()))
+    {
+        LOG_ERR << "Cannot create capture file " << path.toStdString() << std::endl;
+        return false;
+    }
+
+    LOG_INFO << "Capturing serial traffic to " << path.toStdString() << std::endl;
+    return true;
+}
+
+void SerialPortWorker::stopCapture()
+{
+    m_capture.close();
+}
+
+void SerialPortWorker::clearBuffer()
+{
+    if (m_transport)
+    {
+        m_transport->clear();
+    }
+    m_parser.clear();
+}
+
+void SerialPortWorker::setSendWindow(int window)
+{
+    m_sendWindow = std::clamp(window, 1, kMaxSendWindow);
+    processQueue();
+}
+
+void SerialPortWorker::setTimingBounds(const TimingBounds& bounds)
+{
+    m_bounds                   = bounds;
+    m_bounds.maxAckTimeoutMs   = std::max(m_bounds.minAckTimeoutMs, m_bounds.maxAckTimeoutMs);
+    m_bounds.maxCommandDelayMs = std::max(m_bounds.minCommandDelayMs, m_bounds.maxCommandDelayMs);
+    updateDerivedTimings();
+}
+
+void SerialPortWorker::setRetryPolicy(const RetryPolicy& policy)
+{
+    m_retryPolicy            = policy;
+    m_retryPolicy.maxRetries = std::max(0, m_retryPolicy.maxRetries);
+}
+
+LinkState SerialPortWorker::linkState() const
+{
+    LinkState state;
+    state.generation     = m_generation;
+    state.capabilities   = m_deviceCapabilities;
+    state.smoothedRttMs  = m_srttUs / 1000.0;
+    state.rttVarianceMs  = m_rttVarUs / 1000.0;
+    state.ackTimeoutMs   = m_ackTimeoutMs;
+    state.commandDelayMs = m_commandDelayMs;
+    return state;
+}
+
+SerialPortWorker::LaneStats SerialPortWorker::laneStats(Lane lane) const
+{
+    const LaneCounters& counters = m_laneStats[static_cast<size_t>(lane)];
+
+    LaneStats stats;
+    stats.depth       = counters.depth.load(std::memory_order_relaxed);
+    stats.maxDepth    = counters.maxDepth.load(std::memory_order_relaxed);
+    stats.sent        = counters.sent.load(std::memory_order_relaxed);
+    stats.lastWaitUs  = counters.lastWaitUs.load(std::memory_order_relaxed);
+    stats.maxWaitUs   = counters.maxWaitUs.load(std::memory_order_relaxed);
+    stats.totalWaitUs = counters.totalWaitUs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+SerialPortWorker::LinkStats SerialPortWorker::linkStats() const
+{
+    LinkStats stats;
+    stats.framesRx          = m_linkCounters.framesRx.load(std::memory_order_relaxed);
+    stats.framesTx          = m_linkCounters.framesTx.load(std::memory_order_relaxed);
+    stats.bytesRx           = m_linkCounters.bytesRx.load(std::memory_order_relaxed);
+    stats.bytesTx           = m_linkCounters.bytesTx.load(std::memory_order_relaxed);
+    stats.checksumErrors    = m_linkCounters.checksumErrors.load(std::memory_order_relaxed);
+    stats.resyncBytes       = m_linkCounters.resyncBytes.load(std::memory_order_relaxed);
+    stats.ackTimeouts       = m_linkCounters.ackTimeouts.load(std::memory_order_relaxed);
+    stats.retries           = m_linkCounters.retries.load(std::memory_order_relaxed);
+    stats.commandsFailed    = m_linkCounters.commandsFailed.load(std::memory_order_relaxed);
+    stats.queueHighWater    = m_linkCounters.queueHighWater.load(std::memory_order_relaxed);
+    stats.inFlightHighWater = m_linkCounters.inFlightHighWater.load(std::memory_order_relaxed);
+    return stats;
+}
+
+quint64 SerialPortWorker::coalescedFrames() const
+{
+    return m_coalescedFrames.load(std::memory_order_relaxed);
+}
+
+void SerialPortWorker::resetLaneStats()
+{
+    for (size_t i = 0; i < kLaneCount; ++i)
+    {
+        LaneCounters& counters = m_laneStats[i];
+        const int     depth    = static_cast<int>(m_lanes[i].size());
+        counters.depth.store(depth, std::memory_order_relaxed);
+        counters.maxDepth.store(depth, std::memory_order_relaxed);
+        counters.sent.store(0, std::memory_order_relaxed);
+        counters.lastWaitUs.store(0, std::memory_order_relaxed);
+        counters.maxWaitUs.store(0, std::memory_order_relaxed);
+        counters.totalWaitUs.store(0, std::memory_order_relaxed);
+    }
+}
+
+SerialPortWorker::Lane SerialPortWorker::laneFor(Command command)
+{
+    switch (command)
+    {
+        case Command::ButtonPressed:
+        case Command::ButtonReleased:
+        case Command::DiodePressed:
+        case Command::DiodeReleased:
+        case Command::ModeRun:
+        case Command::ModeCheckKeyboard:
+        case Command::ModeConfigure:
+            return Lane::Interactive;
+        default:
+            return Lane::Bulk;
+    }
+}
+
+void SerialPortWorker::sendCommand(Command command, Pins pins)
+{
+    enqueueCommand(command, pins);
+}
+
+void SerialPortWorker::sendCommand(Command command)
+{
+    enqueueCommand(command);
+}
+
+void SerialPortWorker::sendDiodeConfigBatch(const QVector<Pins>& diodes)
+{
+    for (qsizetype offset = 0; offset < diodes.size(); offset += PROTOCOL_DIODE_BATCH_MAX)
+    {
+        const qsizetype count = std::min<qsizetype>(PROTOCOL_DIODE_BATCH_MAX, diodes.size() - offset);
+
+        std::vector<uint8_t> payload(offsetof(DiodeBatchPayload, pins) + count * sizeof(Pins));
+        auto*                batch = reinterpret_cast<DiodeBatchPayload*>(payload.data());
+        batch->count               = static_cast<uint8_t>(count);
+        memcpy(batch->pins, diodes.constData() + offset, count * sizeof(Pins));
+
+        enqueue({Command::ModeDiodeConfigBatch, Pins{0, 0}, std::move(payload)});
+    }
+
+    processQueue();
+}
+
+void SerialPortWorker::handleReadyRead()
+{
+    TraceScope trace(TraceTrack::SerialIO, "read");
+    uint8_t    chunk[FrameParser::kCapacity];
+    int64_t    total = 0;
+
+    while (isTransportOpen())
+    {
+        const int64_t read = m_transport->read(chunk, sizeof(chunk));
+        if (read <= 0)
+        {
+            break;
+        }
+
+        consumeBytes(chunk, static_cast<size_t>(read));
+        total += read;
+    }
+    trace.setArg("bytes", total);
+}
+
+bool SerialPortWorker::isTransportOpen() const
+{
+    return m_transport && m_transport->isOpen();
+}
+
+bool SerialPortWorker::isTransportPassive() const
+{
+    return m_transport && m_transport->isPassive();
+}
+
+void SerialPortWorker::consumeBytes(const uint8_t* data, size_t size)
+{
+    m_capture.write(static_cast<uint64_t>(elapsedUs()), WireDirection::Rx, data, size);
+    m_linkCounters.bytesRx.fetch_add(size, std::memory_order_relaxed);
+
+    // the parser keeps at most one partial frame after a drain, so every pass makes progress
+    while (size > 0)
+    {
+        const size_t accepted = m_parser.feed(data, size);
+        data += accepted;
+        size -= accepted;
+        processBuffer();
+    }
+}
+
+void SerialPortWorker::writeFrame(const std::vector<uint8_t>& frame)
+{
+    if (!isTransportOpen())
+    {
+        return;
+    }
+
+    m_capture.write(static_cast<uint64_t>(elapsedUs()), WireDirection::Tx, frame.data(), frame.size());
+    m_transport->write(frame.data(), frame.size());
+    m_linkCounters.framesTx.fetch_add(1, std::memory_order_relaxed);
+    m_linkCounters.bytesTx.fetch_add(frame.size(), std::memory_order_relaxed);
+}
+
+void SerialPortWorker::handleError(const QString& description)
+{
+    LOG_ERR << "Transport error: " << description.toStdString() << std::endl;
+    SerialEvent event;
+    event.type  = SerialEvent::Type::PortError;
+    event.error = description;
+    postEvent(std::move(event));
+}
+
+void SerialPortWorker::processBuffer()
+{
+    m_parser.drain([this](std::span<const uint8_t> frame) { parsePacket(frame); });
+
+    // the parser counters are not atomic, other threads read the published copies
+    m_linkCounters.checksumErrors.store(m_parser.checksumErrors(), std::memory_order_relaxed);
+    m_linkCounters.resyncBytes.store(m_parser.skippedBytes(), std::memory_order_relaxed);
+}
+
+void SerialPortWorker::parsePacket(std::span<const uint8_t> frame)
+{
+    m_linkCounters.framesRx.fetch_add(1, std::memory_order_relaxed);
+
+    const Packet* rp         = reinterpret_cast<const Packet*>(frame.data());
+    const uint8_t rawCommand = static_cast<uint8_t>(rp->command);
+    const Command command    = command_from_byte(rawCommand);
+    const bool    sequenced  = is_sequenced(rawCommand);
+
+    // bytes between the command and the checksum
+    std::span<const uint8_t> payload = frame.subspan(offsetof(Packet, payload));
+    payload                          = payload.first(payload.size() - 1);
+
+    uint8_t seq = 0;
+    if (sequenced)
+    {
+        if (payload.empty())
+        {
+            LOG_WRN << "Sequenced frame without sequence number, command " << static_cast<int>(command) << std::endl;
+            return;
+        }
+        seq     = payload[0];
+        payload = payload.subspan(1);
+    }
+
+    const auto acknowledge = [this, command, sequenced, seq]()
+    {
+        // a replay never puts commands in flight, its recorded ACKs answer the original session
+        if (isTransportPassive())
+        {
+            return;
+        }
+
+        if (sequenced)
+        {
+            handleSequencedAck(command, seq);
+        }
+        else
+        {
+            handleCommandAck(command);
+        }
+    };
+
+    if (command == Command::Echo)
+    {
+        handleEchoReply(payload);
+        acknowledge();
+        postEvent(SerialEvent{.type = SerialEvent::Type::Echo});
+        return;
+    }
+
+    if (command == Command::DiodeDigest)
+    {
+        acknowledge();
+        handleDiodeDigestReply(payload);
+        return;
+    }
+
+    if (command == Command::StatusUpdate)
+    {
+        TraceScope  trace(TraceTrack::SerialIO, "status decode");
+        StatusFrame status;
+        if (!decodeStatusPayload(payload, status))
+        {
+            LOG_WRN << "Malformed status frame, " << payload.size() << " payload bytes" << std::endl;
+            return;
+        }
+
+        SerialEvent event;
+        event.type        = SerialEvent::Type::Status;
+        event.pins        = status.pins;
+        event.leds        = status.leds;
+        event.timestampUs = monotonicUs();
+        trace.setArg("leds", static_cast<int64_t>(status.leds.size()));
+        postEvent(std::move(event));
+        return;
+    }
+
+    acknowledge();
+    postEvent(SerialEvent{.type = SerialEvent::Type::CommandReceived, .command = command});
+}
+
+void SerialPortWorker::handleEchoReply(std::span<const uint8_t> payload)
+{
+    uint8_t capabilities = 0;
+    if (payload.size() >= sizeof(EchoReplyPayload))
+    {
+        capabilities = reinterpret_cast<const EchoReplyPayload*>(payload.data())->capabilities;
+    }
+
+    if (capabilities == m_deviceCapabilities)
+    {
+        return;
+    }
+
+    LOG_INFO << "Device capabilities 0x" << std::hex << static_cast<int>(capabilities) << std::dec << std::endl;
+    m_deviceCapabilities = capabilities;
+    publishLinkState();
+}
+
+void SerialPortWorker::handleDiodeDigestReply(std::span<const uint8_t> payload)
+{
+    if (payload.size() < sizeof(DiodeDigestPayload))
+    {
+        // an answer without a digest proves nothing about the device table
+        LOG_WRN << "DiodeDigest reply with " << payload.size() << " payload bytes" << std::endl;
+        postEvent(SerialEvent{.type = SerialEvent::Type::CommandFailed, .command = Command::DiodeDigest});
+        return;
+    }
+
+    SerialEvent event;
+    event.type        = SerialEvent::Type::DiodeDigest;
+    event.diodeCount  = payload[offsetof(DiodeDigestPayload, count)];
+    event.diodeDigest = 0;
+    for (size_t i = 0; i < sizeof(uint32_t); ++i)
+    {
+        event.diodeDigest |= static_cast<uint32_t>(payload[offsetof(DiodeDigestPayload, digest) + i]) << (8 * i);
+    }
+    postEvent(std::move(event));
+}
+
+void SerialPortWorker::enqueueCommand(Command command, Pins pins)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&pins);
+    enqueue({command, pins, std::vector<uint8_t>(bytes, bytes + sizeof(pins))});
+    processQueue();
+}
+
+void SerialPortWorker::enqueueCommand(Command command)
+{
+    enqueue({command, Pins{0, 0}, {}});
+    processQueue();
+}
+
+void SerialPortWorker::enqueue(QueuedCommand&& cmd)
+{
+    Tracer& tracer = Tracer::instance();
+    if (coalesce(cmd))
+    {
+        m_coalescedFrames.fetch_add(1, std::memory_order_relaxed);
+        tracer.instant(TraceTrack::Commands, "coalesced", "command", static_cast<int64_t>(cmd.command));
+        return;
+    }
+
+    const size_t lane = static_cast<size_t>(laneFor(cmd.command));
+    cmd.enqueuedUs    = elapsedUs();
+    if (tracer.isEnabled())
+    {
+        cmd.traceId = tracer.nextId();
+        tracer.asyncBegin(TraceTrack::Commands, command_name(cmd.command), cmd.traceId, "lane", lane);
+        tracer.asyncBegin(TraceTrack::Commands, "queued", cmd.traceId);
+    }
+    m_lanes[lane].enqueue(std::move(cmd));
+
+    LaneCounters& stats = m_laneStats[lane];
+    const int     depth = static_cast<int>(m_lanes[lane].size());
+    stats.depth.store(depth, std::memory_order_relaxed);
+    if (depth > stats.maxDepth.load(std::memory_order_relaxed))
+    {
+        stats.maxDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    int totalDepth = 0;
+    for (const auto& queue : m_lanes)
+    {
+        totalDepth += static_cast<int>(queue.size());
+    }
+    raiseTo(m_linkCounters.queueHighWater, totalDepth);
+}
+
+bool SerialPortWorker::coalesce(const QueuedCommand& cmd)
+{
+    // Only commands that have not been written yet are merged. A pending ModeDiodeClear
+    // drops every earlier diode command, so it is always ahead of the remaining ones.
+    const auto& queue = m_lanes[static_cast<size_t>(Lane::Bulk)];
+
+    const auto samePins = [&cmd](const QueuedCommand& other)
+    { return other.pins.pin1 == cmd.pins.pin1 && other.pins.pin2 == cmd.pins.pin2; };
+
+    const auto batchAddsPins = [&cmd](const QueuedCommand& other)
+    {
+        if (other.command != Command::ModeDiodeConfigBatch)
+        {
+            return false;
+        }
+        const auto* batch = reinterpret_cast<const DiodeBatchPayload*>(other.payload.data());
+        return std::any_of(batch->pins,
+                           batch->pins + batch->count,
+                           [&cmd](const Pins& pins)
+                           { return pins.pin1 == cmd.pins.pin1 && pins.pin2 == cmd.pins.pin2; });
+    };
+
+    const auto isDiodeCommand = [](Command command)
+    {
+        return command == Command::ModeDiodeConfig || command == Command::ModeDiodeConfigDel ||
+               command == Command::ModeDiodeClear || command == Command::ModeDiodeConfigBatch;
+    };
+
+    switch (cmd.command)
+    {
+        case Command::ModeDiodeClear:
+        {
+            for (qsizetype i = queue.size() - 1; i >= 0; --i)
+            {
+                if (isDiodeCommand(queue.at(i).command))
+                {
+                    removePending(Lane::Bulk, i);
+                }
+            }
+            return false;
+        }
+        case Command::ModeDiodeConfig:
+        {
+            for (qsizetype i = 0; i < queue.size(); ++i)
+            {
+                const QueuedCommand& pending = queue.at(i);
+                if (pending.command == Command::ModeDiodeConfig && samePins(pending))
+                {
+                    return true;
+                }
+                // delete followed by config leaves the diode configured, the config alone does that
+                if (pending.command == Command::ModeDiodeConfigDel && samePins(pending))
+                {
+                    removePending(Lane::Bulk, i);
+                    return false;
+                }
+            }
+            return false;
+        }
+        case Command::ModeDiodeConfigDel:
+        {
+            const bool clearPending = std::any_of(queue.begin(),
+                                                  queue.end(),
+                                                  [](const QueuedCommand& pending)
+                                                  { return pending.command == Command::ModeDiodeClear; });
+
+            const bool batchAddsDiode = std::any_of(queue.begin(), queue.end(), batchAddsPins);
+            for (qsizetype i = 0; i < queue.size(); ++i)
+            {
+                const QueuedCommand& pending = queue.at(i);
+                if (pending.command == Command::ModeDiodeConfigDel && samePins(pending))
+                {
+                    return true;
+                }
+                if (pending.command == Command::ModeDiodeConfig && samePins(pending))
+                {
+                    removePending(Lane::Bulk, i);
+                    // after a pending clear the pair cancels out, unless a batch behind the clear adds the diode
+                    return clearPending && !batchAddsDiode;
+                }
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+void SerialPortWorker::removePending(Lane lane, qsizetype index)
+{
+    const size_t         laneIndex = static_cast<size_t>(lane);
+    const QueuedCommand& pending   = m_lanes[laneIndex].at(index);
+    endCommandTrace("queued", pending.command, pending.traceId, "coalesced", 1);
+    m_lanes[laneIndex].removeAt(index);
+    m_laneStats[laneIndex].depth.store(static_cast<int>(m_lanes[laneIndex].size()), std::memory_order_relaxed);
+    m_coalescedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SerialPortWorker::processQueue()
+{
+    if (!isTransportOpen())
+    {
+        return;
+    }
+
+    if (m_commandDelayTimer.isActive())
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        const auto& interactive = m_lanes[static_cast<size_t>(Lane::Interactive)];
+        const auto& bulk        = m_lanes[static_cast<size_t>(Lane::Bulk)];
+
+        if (!interactive.isEmpty() && canSend(interactive.head()))
+        {
+            dequeueAndSend(Lane::Interactive);
+        }
+        else if (!bulk.isEmpty() && canSend(bulk.head()))
+        {
+            dequeueAndSend(Lane::Bulk);
+        }
+        else
+        {
+            return;
+        }
+
+        if (m_commandDelayMs > 0)
+        {
+            m_commandDelayTimer.start(m_commandDelayMs);
+            return;
+        }
+    }
+}
+
+bool SerialPortWorker::canSend(const QueuedCommand& cmd) const
+{
+    // unacknowledged commands never wait for the ACK window
+    return !requiresAcknowledgement(cmd.command) || canSendAcknowledged();
+}
+
+void SerialPortWorker::dequeueAndSend(Lane lane)
+{
+    const size_t        index = static_cast<size_t>(lane);
+    const QueuedCommand cmd   = m_lanes[index].dequeue();
+
+    // single writer, readers on other threads only need untorn values
+    const qint64  waitUs = elapsedUs() - cmd.enqueuedUs;
+    LaneCounters& stats  = m_laneStats[index];
+    stats.depth.store(static_cast<int>(m_lanes[index].size()), std::memory_order_relaxed);
+    stats.lastWaitUs.store(waitUs, std::memory_order_relaxed);
+    if (waitUs > stats.maxWaitUs.load(std::memory_order_relaxed))
+    {
+        stats.maxWaitUs.store(waitUs, std::memory_order_relaxed);
+    }
+    stats.totalWaitUs.fetch_add(waitUs, std::memory_order_relaxed);
+    stats.sent.fetch_add(1, std::memory_order_relaxed);
+
+    sendQueuedCommand(cmd);
+}
+
+bool SerialPortWorker::canSendAcknowledged() const
+{
+    const int window = isSequenced() ? m_sendWindow : 1;
+    return m_inFlightCount < window && !m_inFlight[m_nextSeq % kMaxSendWindow].active;
+}
+
+void SerialPortWorker::sendQueuedCommand(const QueuedCommand& cmd)
+{
+    const bool    needsAck  = requiresAcknowledgement(cmd.command);
+    const bool    sequenced = needsAck && isSequenced();
+    const uint8_t seq       = m_nextSeq;
+
+    std::vector<uint8_t> packet = sequenced
+                                      ? build_sequenced_packet(cmd.command, seq, cmd.payload.data(), cmd.payload.size())
+                                      : build_packet(cmd.command, cmd.payload.data(), cmd.payload.size());
+
+    writeFrame(packet);
+
+    // nobody answers during a replay, the recorded ACKs belong to the original session
+    if (!needsAck || isTransportPassive())
+    {
+        endCommandTrace("queued", cmd.command, cmd.traceId, "bytes", static_cast<int64_t>(packet.size()));
+        return;
+    }
+
+    if (cmd.traceId != 0)
+    {
+        Tracer& tracer = Tracer::instance();
+        tracer.asyncEnd(TraceTrack::Commands, "queued", cmd.traceId, "bytes", static_cast<int64_t>(packet.size()));
+        tracer.asyncBegin(TraceTrack::Commands, "awaiting ack", cmd.traceId, "seq", seq);
+    }
+
+    InFlightCommand& slot = m_inFlight[seq % kMaxSendWindow];
+    slot.active           = true;
+    slot.seq              = seq;
+    slot.command          = cmd.command;
+    slot.pins             = cmd.pins;
+    slot.attempts         = 0;
+    slot.sentUs           = elapsedUs();
+    slot.deadlineMs       = m_clock.elapsed() + m_ackTimeoutMs;
+    slot.traceId          = cmd.traceId;
+    slot.frame            = std::move(packet);
+
+    ++m_nextSeq;
+    ++m_inFlightCount;
+    raiseTo(m_linkCounters.inFlightHighWater, m_inFlightCount);
+
+    if (!m_ackTimeoutTimer.isActive())
+    {
+        restartAckTimer();
+    }
+}
+
+void SerialPortWorker::handleCommandAck(Command command)
+{
+    // unsequenced ACK, match the oldest in-flight command of the same type
+    InFlightCommand* oldest = nullptr;
+    for (InFlightCommand& slot : m_inFlight)
+    {
+        if (slot.active && slot.command == command && (!oldest || slot.deadlineMs < oldest->deadlineMs))
+        {
+            oldest = &slot;
+        }
+    }
+
+    if (oldest)
+    {
+        releaseInFlight(*oldest);
+    }
+}
+
+void SerialPortWorker::handleSequencedAck(Command command, uint8_t seq)
+{
+    InFlightCommand& slot = m_inFlight[seq % kMaxSendWindow];
+    if (!slot.active || slot.seq != seq || slot.command != command)
+    {
+        LOG_WRN << "Unexpected ack seq=" << static_cast<int>(seq) << " command " << static_cast<int>(command)
+                << std::endl;
+        return;
+    }
+
+    releaseInFlight(slot);
+}
+
+void SerialPortWorker::releaseInFlight(InFlightCommand& slot)
+{
+    // Karn: the ACK of a retransmitted command is ambiguous
+    if (slot.attempts == 0)
+    {
+        addRttSample(elapsedUs() - slot.sentUs);
+    }
+
+    endCommandTrace("awaiting ack", slot.command, slot.traceId, "attempts", slot.attempts);
+    slot.active = false;
+    slot.frame.clear();
+    --m_inFlightCount;
+    restartAckTimer();
+
+    processQueue();
+}
+
+void SerialPortWorker::endCommandTrace(const char* stage,
+                                       Command     command,
+                                       uint64_t    traceId,
+                                       const char* argName,
+                                       int64_t     arg)
+{
+    if (traceId == 0)
+    {
+        return;
+    }
+
+    Tracer& tracer = Tracer::instance();
+    tracer.asyncEnd(TraceTrack::Commands, stage, traceId);
+    tracer.asyncEnd(TraceTrack::Commands, command_name(command), traceId, argName, arg);
+}
+
+void SerialPortWorker::handleQueueDelayTimeout()
+{
+    processQueue();
+}
+
+void SerialPortWorker::handleAckTimeout()
+{
+    struct FailedCommand
+    {
+        Command command;
+        Pins    pins;
+    };
+
+    std::array<FailedCommand, kMaxSendWindow> failed{};
+    int                                       failedCount = 0;
+
+    const qint64 now = m_clock.elapsed();
+    for (InFlightCommand& slot : m_inFlight)
+    {
+        if (!slot.active || slot.deadlineMs > now)
+        {
+            continue;
+        }
+
+        m_linkCounters.ackTimeouts.fetch_add(1, std::memory_order_relaxed);
+        if (slot.attempts < m_retryPolicy.maxRetries)
+        {
+            retransmit(slot, now);
+            continue;
+        }
+
+        LOG_ERR << "Ack timeout for command " << static_cast<int>(slot.command) << " seq=" << static_cast<int>(slot.seq)
+                << ", giving up after " << slot.attempts << " retries" << std::endl;
+        m_linkCounters.commandsFailed.fetch_add(1, std::memory_order_relaxed);
+        endCommandTrace("awaiting ack", slot.command, slot.traceId, "failed", 1);
+        failed[failedCount++] = {slot.command, slot.pins};
+        slot.active           = false;
+        slot.frame.clear();
+        --m_inFlightCount;
+    }
+
+    restartAckTimer();
+    processQueue();
+
+    for (int i = 0; i < failedCount; ++i)
+    {
+        postEvent(SerialEvent{
+            .type = SerialEvent::Type::CommandFailed, .command = failed[i].command, .pins = failed[i].pins});
+    }
+}
+
+void SerialPortWorker::retransmit(InFlightCommand& slot, qint64 nowMs)
+{
+    ++slot.attempts;
+    m_linkCounters.retries.fetch_add(1, std::memory_order_relaxed);
+    Tracer::instance().instant(TraceTrack::Commands, "retransmit", "seq", slot.seq);
+
+    const qint64 backoffMs = std::min<qint64>(static_cast<qint64>(m_ackTimeoutMs) << slot.attempts,
+                                              std::max(m_ackTimeoutMs, m_retryPolicy.maxBackoffMs));
+
+    LOG_WRN << "Ack timeout for command " << static_cast<int>(slot.command) << " seq=" << static_cast<int>(slot.seq)
+            << ", retransmit " << slot.attempts << "/" << m_retryPolicy.maxRetries << ", next timeout " << backoffMs
+            << " ms" << std::endl;
+
+    writeFrame(slot.frame);
+    slot.deadlineMs = nowMs + backoffMs;
+}
+
+void SerialPortWorker::restartAckTimer()
+{
+    qint64 earliest = -1;
+    for (const InFlightCommand& slot : m_inFlight)
+    {
+        if (slot.active && (earliest < 0 || slot.deadlineMs < earliest))
+        {
+            earliest = slot.deadlineMs;
+        }
+    }
+
+    if (earliest < 0)
+    {
+        m_ackTimeoutTimer.stop();
+        return;
+    }
+
+    m_ackTimeoutTimer.start(static_cast<int>(std::max<qint64>(0, earliest - m_clock.elapsed())));
+}
+
+void SerialPortWorker::clearCommandQueue()
+{
+    if (Tracer::instance().isEnabled())
+    {
+        for (const auto& queue : m_lanes)
+        {
+            for (const QueuedCommand& cmd : queue)
+            {
+                endCommandTrace("queued", cmd.command, cmd.traceId, "dropped", 1);
+            }
+        }
+        for (const InFlightCommand& slot : m_inFlight)
+        {
+            if (slot.active)
+            {
+                endCommandTrace("awaiting ack", slot.command, slot.traceId, "dropped", 1);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < kLaneCount; ++i)
+    {
+        m_lanes[i].clear();
+        m_laneStats[i].depth.store(0, std::memory_order_relaxed);
+    }
+    m_commandDelayTimer.stop();
+    m_ackTimeoutTimer.stop();
+    m_inFlight.fill(InFlightCommand{});
+    m_inFlightCount = 0;
+}
+
+void SerialPortWorker::addRttSample(qint64 rttUs)
+{
+    if (!m_hasRttSample)
+    {
+        m_srttUs       = rttUs;
+        m_rttVarUs     = rttUs / 2;
+        m_hasRttSample = true;
+    }
+    else
+    {
+        // alpha = 1/8, beta = 1/4
+        m_rttVarUs = (3 * m_rttVarUs + std::abs(m_srttUs - rttUs)) / 4;
+        m_srttUs   = (7 * m_srttUs + rttUs) / 8;
+    }
+
+    updateDerivedTimings();
+}
+
+void SerialPortWorker::updateDerivedTimings()
+{
+    int ackTimeoutMs   = kInitialAckTimeoutMs;
+    int commandDelayMs = kInitialCommandDelayMs;
+
+    if (m_hasRttSample)
+    {
+        // RTO = SRTT + 4 * RTTVAR, pacing grows with the link latency
+        ackTimeoutMs   = static_cast<int>((m_srttUs + 4 * m_rttVarUs + 999) / 1000);
+        commandDelayMs = static_cast<int>(m_srttUs / 4000);
+    }
+
+    m_ackTimeoutMs   = std::clamp(ackTimeoutMs, m_bounds.minAckTimeoutMs, m_bounds.maxAckTimeoutMs);
+    m_commandDelayMs = std::clamp(commandDelayMs, m_bounds.minCommandDelayMs, m_bounds.maxCommandDelayMs);
+
+    publishLinkState();
+}
+
+void SerialPortWorker::publishLinkState()
+{
+    SerialEvent event;
+    event.type = SerialEvent::Type::LinkStateChanged;
+    event.link = linkState();
+    postEvent(std::move(event));
+}
+
+void SerialPortWorker::postEvent(SerialEvent&& event)
+{
+    event.generation = m_generation;
+
+    // keep ordering, nothing overtakes events that are already waiting
+    if (!m_backlog.empty() || !m_events->post(std::move(event)))
+    {
+        m_backlog.push_back(std::move(event));
+        if (!m_backlogTimer.isActive())
+        {
+            LOG_WRN << "Serial event queue is full, " << m_backlog.size() << " events postponed" << std::endl;
+            m_backlogTimer.start(kBacklogRetryMs);
+        }
+    }
+}
+
+void SerialPortWorker::flushBacklog()
+{
+    while (!m_backlog.empty() && m_events->post(std::move(m_backlog.front())))
+    {
+        m_backlog.pop_front();
+    }
+
+    if (!m_backlog.empty())
+    {
+        m_backlogTimer.start(kBacklogRetryMs);
+    }
+}
+
+qint64 SerialPortWorker::elapsedUs() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+bool SerialPortWorker::isSequenced() const
+{
+    return (m_deviceCapabilities & PROTOCOL_CAP_SEQUENCE) != 0;
+}
+
+bool SerialPortWorker::requiresAcknowledgement(Command command)
+{
+    switch (command)
+    {
+        case Command::Echo:
+        case Command::ModeDiodeConfig:
+        case Command::ModeDiodeConfigDel:
+        case Command::ModeDiodeClear:
+        case Command::ModeDiodeConfigBatch:
+        case Command::DiodeDigest:
+            return true;
+        default:
+            return false;
+    }
+}
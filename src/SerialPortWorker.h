@@ -0,0 +1,274 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QQueue>
+#include <QTimer>
+#include <QVector>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "FrameParser.h"
+#include "ITransport.h"
+#include "KeyboardControllerProtocol.h"
+#include "SerialEvent.h"
+#include "WireCapture.h"
+
+// Transport, frame parser, command queue and protocol timers.
+// Lives on the serial I/O thread, SerialPortModel is its GUI-thread facade: calls come in as
+// queued invocations, decoded events go out through a SerialEventChannel.
+class SerialPortWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Limits for the RTT derived ACK timeout and inter-command delay
+    struct TimingBounds
+    {
+        int minAckTimeoutMs{20};
+        int maxAckTimeoutMs{1000};
+        int minCommandDelayMs{1};
+        int maxCommandDelayMs{20};
+    };
+
+    // Commands of the interactive lane are always written before the bulk lane
+    enum class Lane
+    {
+        Interactive, // button/diode presses and mode switches
+        Bulk,        // diode table sync and echo heartbeats
+        Count
+    };
+
+    struct LaneStats
+    {
+        int     depth{0};
+        int     maxDepth{0};
+        quint64 sent{0};
+        qint64  lastWaitUs{0};
+        qint64  maxWaitUs{0};
+        qint64  totalWaitUs{0};
+    };
+
+    // Link health counters, monotonic for the lifetime of the worker
+    struct LinkStats
+    {
+        quint64 framesRx{0};
+        quint64 framesTx{0}; // retransmissions included
+        quint64 bytesRx{0};
+        quint64 bytesTx{0};
+        quint64 checksumErrors{0};
+        quint64 resyncBytes{0}; // skipped while searching for the next SOF
+        quint64 ackTimeouts{0};
+        quint64 retries{0};
+        quint64 commandsFailed{0}; // given up after all retries
+        int     queueHighWater{0}; // both lanes together
+        int     inFlightHighWater{0};
+    };
+
+    // Retransmission of acknowledged commands, the timeout doubles on every attempt
+    struct RetryPolicy
+    {
+        int maxRetries{3};
+        int maxBackoffMs{2000};
+    };
+
+    explicit SerialPortWorker(SerialEventChannel* events, QObject* parent = nullptr);
+    ~SerialPortWorker();
+
+    // Takes over the transport, which must belong to the worker thread. Non-zero capabilities come
+    // from an Echo answered before the hand-over and stand in for the first Echo of the session.
+    bool openTransport(std::unique_ptr<ITransport> transport, uint8_t capabilities = 0);
+    void closePort();
+
+    // Records every received chunk and transmitted frame until stopCapture()
+    bool startCapture(const QString& path);
+    void stopCapture();
+
+    void clearBuffer();
+
+    void setSendWindow(int window);
+    void setTimingBounds(const TimingBounds& bounds);
+    void setRetryPolicy(const RetryPolicy& policy);
+
+    // Snapshot of the published link parameters, worker thread only
+    LinkState linkState() const;
+
+    // Safe to call from any thread
+    LaneStats laneStats(Lane lane) const;
+    LinkStats linkStats() const;
+    quint64   coalescedFrames() const;
+
+    void resetLaneStats();
+
+    static Lane laneFor(Command command);
+
+    void sendCommand(Command command, Pins pins);
+    void sendCommand(Command command);
+    void sendDiodeConfigBatch(const QVector<Pins>& diodes);
+
+private slots:
+    void handleReadyRead();
+
+    void handleError(const QString& description);
+
+    void flushBacklog();
+
+private:
+    bool isTransportOpen() const;
+    bool isTransportPassive() const;
+    void consumeBytes(const uint8_t* data, size_t size);
+    void writeFrame(const std::vector<uint8_t>& frame);
+
+    void processBuffer();
+
+    void parsePacket(std::span<const uint8_t> frame);
+
+    void handleEchoReply(std::span<const uint8_t> payload);
+    void handleDiodeDigestReply(std::span<const uint8_t> payload);
+
+    struct QueuedCommand
+    {
+        Command command{Command::None};
+        Pins    pins{0, 0};
+
+        std::vector<uint8_t> payload; // command body without framing
+
+        qint64   enqueuedUs{0};
+        uint64_t traceId{0}; // async span of the command while tracing
+    };
+
+    struct InFlightCommand
+    {
+        bool     active{false};
+        uint8_t  seq{0};
+        Command  command{Command::None};
+        Pins     pins{0, 0};
+        int      attempts{0};
+        qint64   sentUs{0};
+        qint64   deadlineMs{0};
+        uint64_t traceId{0};
+
+        std::vector<uint8_t> frame; // kept for retransmission
+    };
+
+    void enqueueCommand(Command command, Pins pins);
+    void enqueueCommand(Command command);
+    void enqueue(QueuedCommand&& cmd);
+    bool coalesce(const QueuedCommand& cmd);
+    void removePending(Lane lane, qsizetype index);
+    void processQueue();
+    bool canSend(const QueuedCommand& cmd) const;
+    bool canSendAcknowledged() const;
+    void dequeueAndSend(Lane lane);
+    void sendQueuedCommand(const QueuedCommand& cmd);
+    void handleCommandAck(Command command);
+    void handleSequencedAck(Command command, uint8_t seq);
+    void releaseInFlight(InFlightCommand& slot);
+    void endCommandTrace(const char* stage, Command command, uint64_t traceId, const char* argName, int64_t arg);
+    void retransmit(InFlightCommand& slot, qint64 nowMs);
+    void handleQueueDelayTimeout();
+    void handleAckTimeout();
+    void restartAckTimer();
+    void clearCommandQueue();
+
+    void addRttSample(qint64 rttUs);
+    void updateDerivedTimings();
+
+    void publishLinkState();
+    void postEvent(SerialEvent&& event);
+
+    qint64 elapsedUs() const;
+    bool   isSequenced() const;
+
+    static bool requiresAcknowledgement(Command command);
+
+    static constexpr int kMaxSendWindow = 32; // divides 256, so seq % kMaxSendWindow is stable across wrap
+    static_assert(kMaxSendWindow <= PROTOCOL_SEQ_HISTORY, "a retransmitted seq must still be in the device history");
+
+    // Written on the worker thread only, read from any thread
+    struct LaneCounters
+    {
+        std::atomic<int>     depth{0};
+        std::atomic<int>     maxDepth{0};
+        std::atomic<quint64> sent{0};
+        std::atomic<qint64>  lastWaitUs{0};
+        std::atomic<qint64>  maxWaitUs{0};
+        std::atomic<qint64>  totalWaitUs{0};
+    };
+
+    struct LinkCounters
+    {
+        std::atomic<quint64> framesRx{0};
+        std::atomic<quint64> framesTx{0};
+        std::atomic<quint64> bytesRx{0};
+        std::atomic<quint64> bytesTx{0};
+        std::atomic<quint64> checksumErrors{0};
+        std::atomic<quint64> resyncBytes{0};
+        std::atomic<quint64> ackTimeouts{0};
+        std::atomic<quint64> retries{0};
+        std::atomic<quint64> commandsFailed{0};
+        std::atomic<int>     queueHighWater{0};
+        std::atomic<int>     inFlightHighWater{0};
+    };
+
+    // written on the worker thread only
+    static void raiseTo(std::atomic<int>& highWater, int value)
+    {
+        if (value > highWater.load(std::memory_order_relaxed))
+        {
+            highWater.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    std::unique_ptr<ITransport> m_transport;
+    SerialEventChannel*         m_events;
+    FrameParser                 m_parser;
+    WireCaptureWriter           m_capture;
+
+    // Events the consumer had no room for yet
+    std::deque<SerialEvent> m_backlog;
+
+    uint32_t m_generation{0};
+
+    static constexpr size_t kLaneCount = static_cast<size_t>(Lane::Count);
+
+    std::array<QQueue<QueuedCommand>, kLaneCount> m_lanes;
+    std::array<LaneCounters, kLaneCount>          m_laneStats;
+
+    LinkCounters         m_linkCounters;
+    std::atomic<quint64> m_coalescedFrames{0};
+
+    std::array<InFlightCommand, kMaxSendWindow> m_inFlight{};
+
+    int     m_inFlightCount{0};
+    int     m_sendWindow{8};
+    uint8_t m_nextSeq{0};
+    uint8_t m_deviceCapabilities{0};
+
+    // Parented so moveToThread() takes them along
+    QTimer        m_commandDelayTimer;
+    QTimer        m_ackTimeoutTimer;
+    QTimer        m_backlogTimer;
+    QElapsedTimer m_clock;
+
+    TimingBounds m_bounds{};
+    RetryPolicy  m_retryPolicy{};
+
+    // RFC 6298 style estimator, microseconds
+    qint64 m_srttUs{0};
+    qint64 m_rttVarUs{0};
+    bool   m_hasRttSample{false};
+
+    int m_ackTimeoutMs{kInitialAckTimeoutMs};
+    int m_commandDelayMs{kInitialCommandDelayMs};
+
+    // Used until the first RTT sample is available
+    static constexpr int kInitialCommandDelayMs = 5;
+    static constexpr int kInitialAckTimeoutMs   = 200;
+
+    static constexpr int kBacklogRetryMs = 5;
+};
@@ -0,0 +1,71 @@
+#include "SerialTransport.h"
+
+SerialTransport::SerialTransport(const QString& portName, int baudRate, QObject* parent)
+    : ITransport(parent), m_serial(this), m_baudRate(baudRate)
+{
+    m_serial.setPortName(portName);
+
+    connect(&m_serial, &QSerialPort::readyRead, this, &ITransport::readyRead);
+    connect(&m_serial, &QSerialPort::errorOccurred, this, &SerialTransport::handleError);
+}
+
+bool SerialTransport::open()
+{
+    // handed over already open by a PortProbe, opening again would toggle DTR and reset some boards
+    if (m_serial.isOpen())
+    {
+        return true;
+    }
+
+    m_serial.setBaudRate(m_baudRate);
+    m_serial.setDataBits(QSerialPort::Data8);
+    m_serial.setParity(QSerialPort::NoParity);
+    m_serial.setStopBits(QSerialPort::OneStop);
+    m_serial.setFlowControl(QSerialPort::NoFlowControl);
+    return m_serial.open(QIODevice::ReadWrite);
+}
+
+void SerialTransport::close()
+{
+    m_serial.close();
+}
+
+bool SerialTransport::isOpen() const
+{
+    return m_serial.isOpen();
+}
+
+int64_t SerialTransport::read(uint8_t* data, size_t maxSize)
+{
+    return m_serial.read(reinterpret_cast<char*>(data), static_cast<qint64>(maxSize));
+}
+
+int64_t SerialTransport::write(const uint8_t* data, size_t size)
+{
+    return m_serial.write(reinterpret_cast<const char*>(data), static_cast<qint64>(size));
+}
+
+void SerialTransport::clear()
+{
+    m_serial.skip(m_serial.bytesAvailable());
+}
+
+QString SerialTransport::description() const
+{
+    return QString("%1 at %2 baud").arg(m_serial.portName()).arg(m_baudRate);
+}
+
+QString SerialTransport::errorString() const
+{
+    return m_serial.errorString();
+}
+
+void SerialTransport::handleError(QSerialPort::SerialPortError error)
+{
+    if (error == QSerialPort::NoError)
+    {
+        return;
+    }
+
+    emit errorOccurred(m_serial.errorString());
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QSerialPort>
+
+#include "ITransport.h"
+
+// 8N1 serial port without flow control
+class SerialTransport : public ITransport
+{
+    Q_OBJECT
+
+public:
+    SerialTransport(const QString& portName, int baudRate, QObject* parent = nullptr);
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override;
+
+    int64_t read(uint8_t* data, size_t maxSize) override;
+    int64_t write(const uint8_t* data, size_t size) override;
+
+    void clear() override;
+
+    QString description() const override;
+    QString errorString() const override;
+
+private slots:
+    void handleError(QSerialPort::SerialPortError error);
+
+private:
+    QSerialPort m_serial;
+    int         m_baudRate;
+};
@@ -0,0 +1,112 @@
+#include "StatusCoalescer.h"
+
+#include <algorithm>
+
+StatusCoalescer::StatusCoalescer(int intervalMs, QObject* parent)
+    : QObject(parent), m_timer(this), m_intervalMs(std::max(1, intervalMs))
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &StatusCoalescer::deliver);
+}
+
+void StatusCoalescer::setInterval(int intervalMs)
+{
+    m_intervalMs = std::max(1, intervalMs);
+}
+
+void StatusCoalescer::push(Pins pins, const LedList& leds)
+{
+    ++m_framesReceived;
+
+    m_lastFrame.reset();
+    for (const Pins& led : leds)
+    {
+        const int index = PinMatrix::indexOf(led.pin1, led.pin2);
+        if (index >= 0)
+        {
+            m_lastFrame.set(index);
+        }
+    }
+    m_latched |= m_lastFrame;
+
+    m_pins = pins;
+    if (pins.pin1 != 0 || pins.pin2 != 0)
+    {
+        m_latchedPins = pins;
+    }
+    ++m_pendingFrames;
+
+    if (m_timer.isActive())
+    {
+        return;
+    }
+
+    // an idle link gets the frame right away, a flood is paced to the display rate
+    const qint64 elapsed = m_sinceDelivery.isValid() ? m_sinceDelivery.elapsed() : m_intervalMs;
+    m_timer.start(static_cast<int>(std::max<qint64>(0, m_intervalMs - elapsed)));
+}
+
+void StatusCoalescer::reset()
+{
+    m_timer.stop();
+    m_framesDropped += m_pendingFrames;
+    m_pendingFrames   = 0;
+    m_followUpPending = false;
+    m_pins            = Pins{0, 0};
+    m_latchedPins     = Pins{0, 0};
+    m_lastFrame.reset();
+    m_latched.reset();
+}
+
+void StatusCoalescer::deliver()
+{
+    if (m_pendingFrames == 0)
+    {
+        // the device sends status on change only, without this a released pulse would stay on screen
+        if (m_followUpPending)
+        {
+            m_followUpPending = false;
+            emitSnapshot(m_pins, m_lastFrame);
+        }
+        return;
+    }
+
+    const PinMatrix::Set pulses = m_latched & ~m_lastFrame;
+    m_pulsesLatched += pulses.count();
+
+    // a button released within the interval is still shown for one display frame
+    const bool released = m_pins.pin1 == 0 && m_pins.pin2 == 0;
+    const Pins pins     = released ? m_latchedPins : m_pins;
+
+    m_framesMerged += m_pendingFrames - 1;
+    m_pendingFrames   = 0;
+    m_followUpPending = pulses.any() || pins.pin1 != m_pins.pin1 || pins.pin2 != m_pins.pin2;
+    m_latchedPins     = Pins{0, 0};
+
+    const PinMatrix::Set latched = m_latched;
+    m_latched.reset();
+    emitSnapshot(pins, latched);
+
+    if (m_followUpPending)
+    {
+        m_timer.start(m_intervalMs);
+    }
+}
+
+void StatusCoalescer::emitSnapshot(Pins pins, const PinMatrix::Set& leds)
+{
+    m_leds.clear();
+    for (int index = 0; index < PinMatrix::kSize; ++index)
+    {
+        if (leds.test(index))
+        {
+            m_leds.push_back(PinMatrix::pinsAt(index));
+        }
+    }
+
+    ++m_framesDelivered;
+    m_sinceDelivery.start();
+
+    emit statusReady(pins, m_leds);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include "PinMatrix.h"
+#include "PinsDefinition.h"
+#include "StatusFrame.h"
+
+// Merges StatusUpdate frames into one snapshot that is handed to the UI at most once per display frame.
+// LEDs that were lit at any point since the last delivery are latched, so short pulses stay visible.
+// A snapshot that showed such a pulse is followed one interval later by the frame the device last sent.
+class StatusCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StatusCoalescer(int intervalMs, QObject* parent = nullptr);
+
+    void setInterval(int intervalMs);
+
+    quint64 framesReceived() const { return m_framesReceived; }
+    quint64 framesDelivered() const { return m_framesDelivered; }
+    quint64 framesMerged() const { return m_framesMerged; }   // folded into a later snapshot
+    quint64 framesDropped() const { return m_framesDropped; } // discarded by reset()
+    quint64 pulsesLatched() const { return m_pulsesLatched; }
+
+public slots:
+    void push(Pins pins, const LedList& leds);
+
+    // Drops a pending snapshot, e.g. when the connection is lost
+    void reset();
+
+signals:
+    void statusReady(Pins pins, const LedList& leds);
+
+private slots:
+    void deliver();
+
+private:
+    void emitSnapshot(Pins pins, const PinMatrix::Set& leds);
+
+    QTimer        m_timer;
+    QElapsedTimer m_sinceDelivery;
+    int           m_intervalMs;
+
+    int            m_pendingFrames{0};
+    bool           m_followUpPending{false}; // the last snapshot showed a pulse that is over by now
+    Pins           m_pins{0, 0};
+    Pins           m_latchedPins{0, 0}; // last pressed pins seen since the previous delivery
+    PinMatrix::Set m_lastFrame;
+    PinMatrix::Set m_latched;
+    LedList        m_leds;
+
+    quint64 m_framesReceived{0};
+    quint64 m_framesDelivered{0};
+    quint64 m_framesMerged{0};
+    quint64 m_framesDropped{0};
+    quint64 m_pulsesLatched{0};
+};
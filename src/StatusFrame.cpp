@@ -0,0 +1,27 @@
+#include "StatusFrame.h"
+
+#include "KeyboardControllerProtocol.h"
+
+bool decodeStatusPayload(std::span<const uint8_t> payload, StatusFrame& out)
+{
+    constexpr size_t kHeaderSize = offsetof(StatusPayload, leds);
+    if (payload.size() < kHeaderSize)
+    {
+        return false;
+    }
+
+    const StatusPayload* status  = reinterpret_cast<const StatusPayload*>(payload.data());
+    const size_t         ledsNum = status->leds_num;
+    if (ledsNum > LedList::kCapacity || ledsNum * sizeof(Pins) > payload.size() - kHeaderSize)
+    {
+        return false;
+    }
+
+    out.pins = status->pins;
+    out.leds.clear();
+    for (size_t i = 0; i < ledsNum; ++i)
+    {
+        out.leds.push_back(status->leds[i]);
+    }
+    return true;
+}
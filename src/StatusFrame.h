@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "PinMatrix.h"
+#include "PinsDefinition.h"
+
+// LED list of one StatusUpdate frame, stored inline so decoding and passing it on never touch the heap
+class LedList
+{
+public:
+    static constexpr size_t kCapacity = PinMatrix::kSize;
+
+    // false when the list is full
+    bool push_back(Pins pins)
+    {
+        if (m_size == kCapacity)
+        {
+            return false;
+        }
+        m_items[m_size++] = pins;
+        return true;
+    }
+
+    void clear() { m_size = 0; }
+
+    size_t size() const { return m_size; }
+    bool   empty() const { return m_size == 0; }
+
+    const Pins* begin() const { return m_items.data(); }
+    const Pins* end() const { return m_items.data() + m_size; }
+
+    const Pins& operator[](size_t index) const { return m_items[index]; }
+
+private:
+    std::array<Pins, kCapacity> m_items;
+    size_t                      m_size{0};
+};
+
+struct StatusFrame
+{
+    Pins    pins{0, 0};
+    LedList leds;
+};
+
+// Decodes the bytes between the command and the checksum of a StatusUpdate frame.
+// Returns false when leds_num does not fit the payload or the inline capacity.
+bool decodeStatusPayload(std::span<const uint8_t> payload, StatusFrame& out);
@@ -0,0 +1,62 @@
+#include "TcpTransport.h"
+
+TcpTransport::TcpTransport(const QString& host, quint16 port, QObject* parent)
+    : ITransport(parent), m_socket(this), m_host(host), m_port(port)
+{
+    connect(&m_socket, &QTcpSocket::readyRead, this, &ITransport::readyRead);
+    connect(&m_socket, &QTcpSocket::errorOccurred, this, &TcpTransport::handleError);
+}
+
+bool TcpTransport::open()
+{
+    m_socket.connectToHost(m_host, m_port);
+    if (!m_socket.waitForConnected(kConnectTimeoutMs))
+    {
+        m_socket.abort();
+        return false;
+    }
+
+    // frames are small and latency bound
+    m_socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    return true;
+}
+
+void TcpTransport::close()
+{
+    m_socket.abort();
+}
+
+bool TcpTransport::isOpen() const
+{
+    return m_socket.state() == QAbstractSocket::ConnectedState;
+}
+
+int64_t TcpTransport::read(uint8_t* data, size_t maxSize)
+{
+    return m_socket.read(reinterpret_cast<char*>(data), static_cast<qint64>(maxSize));
+}
+
+int64_t TcpTransport::write(const uint8_t* data, size_t size)
+{
+    return m_socket.write(reinterpret_cast<const char*>(data), static_cast<qint64>(size));
+}
+
+void TcpTransport::clear()
+{
+    m_socket.skip(m_socket.bytesAvailable());
+}
+
+QString TcpTransport::description() const
+{
+    return QString("tcp://%1:%2").arg(m_host).arg(m_port);
+}
+
+QString TcpTransport::errorString() const
+{
+    return m_socket.errorString();
+}
+
+void TcpTransport::handleError(QAbstractSocket::SocketError)
+{
+    emit errorOccurred(m_socket.errorString());
+}
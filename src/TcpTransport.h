@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QTcpSocket>
+
+#include "ITransport.h"
+
+// Device behind a TCP socket, e.g. socat TCP-LISTEN:5555 /dev/ttyUSB0 or a remote simulator
+class TcpTransport : public ITransport
+{
+    Q_OBJECT
+
+public:
+    TcpTransport(const QString& host, quint16 port, QObject* parent = nullptr);
+
+    // Waits up to kConnectTimeoutMs for the connection
+    bool open() override;
+    void close() override;
+    bool isOpen() const override;
+
+    int64_t read(uint8_t* data, size_t maxSize) override;
+    int64_t write(const uint8_t* data, size_t size) override;
+
+    void clear() override;
+
+    QString description() const override;
+    QString errorString() const override;
+
+private slots:
+    void handleError(QAbstractSocket::SocketError error);
+
+private:
+    QTcpSocket m_socket;
+    QString    m_host;
+    quint16    m_port;
+
+    static constexpr int kConnectTimeoutMs = 1000;
+};
@@ -0,0 +1,186 @@
+#include "Tracer.h"
+
+#include <cinttypes>
+
+#include "logger.h"
+
+namespace
+{
+
+const char* trackName(TraceTrack track)
+{
+    switch (track)
+    {
+        case TraceTrack::Commands:
+            return "Commands";
+        case TraceTrack::SerialIO:
+            return "Serial I/O";
+        case TraceTrack::Connection:
+            return "Connection";
+        case TraceTrack::DiodeSync:
+            return "Diode sync";
+        case TraceTrack::Scene:
+            return "Scene";
+        default:
+            return "Unknown";
+    }
+}
+
+// Async spans of one track share a category, so Perfetto groups them under the track name
+const char* trackCategory(TraceTrack track)
+{
+    switch (track)
+    {
+        case TraceTrack::Commands:
+            return "commands";
+        case TraceTrack::SerialIO:
+            return "serial";
+        case TraceTrack::Connection:
+            return "connection";
+        case TraceTrack::DiodeSync:
+            return "diodesync";
+        case TraceTrack::Scene:
+            return "scene";
+        default:
+            return "unknown";
+    }
+}
+
+} // namespace
+
+Tracer& Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::~Tracer()
+{
+    // the logger may already be gone at static destruction, write quietly
+    if (m_enabled.exchange(false, std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        writeFile();
+    }
+}
+
+bool Tracer::start(const std::string& path)
+{
+    // fail early instead of after the whole session
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        LOG_ERR << "Cannot create trace file " << path << std::endl;
+        return false;
+    }
+    std::fclose(file);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path    = path;
+    m_startUs = monotonicUs();
+    m_dropped = 0;
+    m_events.clear();
+    m_events.reserve(4096);
+    m_enabled.store(true, std::memory_order_relaxed);
+
+    LOG_INFO << "Tracing to " << path << std::endl;
+    return true;
+}
+
+void Tracer::stop()
+{
+    if (!m_enabled.exchange(false, std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!writeFile())
+    {
+        LOG_ERR << "Cannot write trace file " << m_path << std::endl;
+        return;
+    }
+
+    LOG_INFO << "Trace with " << m_events.size() << " events written to " << m_path << ", " << m_dropped
+             << " dropped" << std::endl;
+    m_events.clear();
+    m_events.shrink_to_fit();
+}
+
+void Tracer::record(const Event& event)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_events.size() >= kMaxEvents)
+    {
+        ++m_dropped;
+        return;
+    }
+    m_events.push_back(event);
+}
+
+bool Tracer::writeFile() const
+{
+    std::FILE* file = std::fopen(m_path.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    write(file);
+    return std::fclose(file) == 0;
+}
+
+void Tracer::write(std::FILE* file) const
+{
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(file,
+                 "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+                 "\"args\":{\"name\":\"KeyboardEmulator\"}}");
+
+    // tids start at 1, the track order is the order of TraceTrack
+    for (int track = 0; track < static_cast<int>(TraceTrack::Count); ++track)
+    {
+        std::fprintf(file,
+                     ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     track + 1,
+                     trackName(static_cast<TraceTrack>(track)));
+        std::fprintf(file,
+                     ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                     "\"args\":{\"sort_index\":%d}}",
+                     track + 1,
+                     track);
+    }
+
+    for (const Event& event : m_events)
+    {
+        const int tid = static_cast<int>(event.track) + 1;
+        std::fprintf(file,
+                     ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRId64 ",\"pid\":1,\"tid\":%d",
+                     event.name,
+                     trackCategory(event.track),
+                     event.phase,
+                     event.timestampUs - m_startUs,
+                     tid);
+
+        if (event.phase == 'X')
+        {
+            std::fprintf(file, ",\"dur\":%" PRId64, event.durationUs);
+        }
+        else if (event.phase == 'i')
+        {
+            std::fprintf(file, ",\"s\":\"t\"");
+        }
+        else
+        {
+            std::fprintf(file, ",\"id\":\"0x%" PRIx64 "\"", event.id);
+        }
+
+        if (event.argName)
+        {
+            std::fprintf(file, ",\"args\":{\"%s\":%" PRId64 "}", event.argName, event.arg);
+        }
+        std::fprintf(file, "}");
+    }
+
+    std::fprintf(file, "\n]}\n");
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MonotonicClock.h"
+
+// One track of the trace per subsystem
+enum class TraceTrack : uint8_t
+{
+    Commands,   // command lifecycle: queued, written, acknowledged
+    SerialIO,   // reads and status frame decoding on the I/O thread
+    Connection, // auto-connect, probing and heartbeats
+    DiodeSync,  // full diode table synchronisation
+    Scene,      // status applied to the scene and repaints
+    Count
+};
+
+// Opt-in recorder of Chrome trace-event JSON, opens in Perfetto or chrome://tracing.
+//
+// Disabled, every call is one relaxed load. Enabled, events are buffered in memory and
+// written by stop(). Names are not copied and must be string literals.
+class Tracer
+{
+public:
+    static Tracer& instance();
+
+    ~Tracer();
+
+    Tracer(const Tracer&)            = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Starts recording, the file is written by stop()
+    bool start(const std::string& path);
+    void stop();
+
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // Identifies the begin/end pair of an async span
+    uint64_t nextId() { return m_nextId.fetch_add(1, std::memory_order_relaxed); }
+
+    void complete(TraceTrack  track,
+                  const char* name,
+                  int64_t     startUs,
+                  int64_t     endUs,
+                  const char* argName = nullptr,
+                  int64_t     arg     = 0)
+    {
+        if (isEnabled())
+        {
+            record({name, 'X', track, startUs, endUs - startUs, 0, argName, arg});
+        }
+    }
+
+    void instant(TraceTrack track, const char* name, const char* argName = nullptr, int64_t arg = 0)
+    {
+        if (isEnabled())
+        {
+            record({name, 'i', track, monotonicUs(), 0, 0, argName, arg});
+        }
+    }
+
+    // Spans that start and end in different functions or threads, nested by the same id
+    void asyncBegin(TraceTrack track, const char* name, uint64_t id, const char* argName = nullptr, int64_t arg = 0)
+    {
+        if (isEnabled())
+        {
+            record({name, 'b', track, monotonicUs(), 0, id, argName, arg});
+        }
+    }
+
+    void asyncEnd(TraceTrack track, const char* name, uint64_t id, const char* argName = nullptr, int64_t arg = 0)
+    {
+        if (isEnabled())
+        {
+            record({name, 'e', track, monotonicUs(), 0, id, argName, arg});
+        }
+    }
+
+private:
+    Tracer() = default;
+
+    struct Event
+    {
+        const char* name;
+        char        phase;
+        TraceTrack  track;
+        int64_t     timestampUs;
+        int64_t     durationUs;
+        uint64_t    id;
+        const char* argName;
+        int64_t     arg;
+    };
+
+    void record(const Event& event);
+    bool writeFile() const;
+    void write(std::FILE* file) const;
+
+    // About 64 MiB, later events are counted and dropped
+    static constexpr size_t kMaxEvents = size_t{1} << 20;
+
+    std::atomic<bool>     m_enabled{false};
+    std::atomic<uint64_t> m_nextId{1};
+
+    std::mutex         m_mutex;
+    std::vector<Event> m_events;
+    std::string        m_path;
+    int64_t            m_startUs{0};
+    uint64_t           m_dropped{0};
+};
+
+// Complete event covering the enclosing scope
+class TraceScope
+{
+public:
+    TraceScope(TraceTrack track, const char* name)
+        : m_track(track), m_name(name), m_startUs(Tracer::instance().isEnabled() ? monotonicUs() : -1)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_startUs >= 0)
+        {
+            Tracer::instance().complete(m_track, m_name, m_startUs, monotonicUs(), m_argName, m_arg);
+        }
+    }
+
+    TraceScope(const TraceScope&)            = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    void setArg(const char* name, int64_t value)
+    {
+        m_argName = name;
+        m_arg     = value;
+    }
+
+private:
+    TraceTrack  m_track;
+    const char* m_name;
+    int64_t     m_startUs;
+    const char* m_argName{nullptr};
+    int64_t     m_arg{0};
+};
@@ -0,0 +1,231 @@
+#include "WireCapture.h"
+
+#include <cstring>
+
+namespace
+{
+
+constexpr uint32_t kSectionHeaderBlock  = 0x0A0D0D0A;
+constexpr uint32_t kInterfaceBlock      = 0x00000001;
+constexpr uint32_t kEnhancedPacketBlock = 0x00000006;
+constexpr uint32_t kByteOrderMagic      = 0x1A2B3C4D;
+constexpr uint16_t kLinkTypeUser0       = 147;
+
+constexpr uint16_t kOptionEnd      = 0;
+constexpr uint16_t kOptionTsResol  = 9; // interface option
+constexpr uint16_t kOptionEpbFlags = 2; // packet option
+
+// epb_flags direction bits
+constexpr uint32_t kFlagInbound  = 0x1;
+constexpr uint32_t kFlagOutbound = 0x2;
+
+// block type + total length at the start, total length again at the end
+constexpr size_t kBlockFraming = 12;
+
+// interface id, timestamp high/low, captured and original length
+constexpr size_t kPacketHeader = 20;
+
+size_t padded(size_t size)
+{
+    return (size + 3) & ~size_t{3};
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value)
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+void putOption(std::vector<uint8_t>& out, uint16_t code, const void* value, uint16_t length)
+{
+    put<uint16_t>(out, code);
+    put<uint16_t>(out, length);
+    const auto* bytes = static_cast<const uint8_t*>(value);
+    out.insert(out.end(), bytes, bytes + length);
+    out.resize(padded(out.size()), 0);
+}
+
+void finishBlock(std::vector<uint8_t>& block)
+{
+    const uint32_t length = static_cast<uint32_t>(block.size() + sizeof(uint32_t));
+    std::memcpy(block.data() + sizeof(uint32_t), &length, sizeof(length));
+    put<uint32_t>(block, length);
+}
+
+}
+
+WireCaptureWriter::~WireCaptureWriter()
+{
+    close();
+}
+
+bool WireCaptureWriter::open(const std::string& path)
+{
+    close();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file)
+    {
+        return false;
+    }
+
+    writeHeader();
+    return true;
+}
+
+void WireCaptureWriter::close()
+{
+    if (m_file)
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+void WireCaptureWriter::writeHeader()
+{
+    std::vector<uint8_t> block;
+
+    put<uint32_t>(block, kSectionHeaderBlock);
+    put<uint32_t>(block, 0);
+    put<uint32_t>(block, kByteOrderMagic);
+    put<uint16_t>(block, 1); // major version
+    put<uint16_t>(block, 0); // minor version
+    put<int64_t>(block, -1); // section length not known
+    finishBlock(block);
+    std::fwrite(block.data(), 1, block.size(), m_file);
+
+    block.clear();
+    const uint8_t microseconds = 6;
+    put<uint32_t>(block, kInterfaceBlock);
+    put<uint32_t>(block, 0);
+    put<uint16_t>(block, kLinkTypeUser0);
+    put<uint16_t>(block, 0); // reserved
+    put<uint32_t>(block, 0); // no snap length limit
+    putOption(block, kOptionTsResol, &microseconds, sizeof(microseconds));
+    putOption(block, kOptionEnd, nullptr, 0);
+    finishBlock(block);
+    std::fwrite(block.data(), 1, block.size(), m_file);
+
+    std::fflush(m_file);
+}
+
+void WireCaptureWriter::write(uint64_t timestampUs, WireDirection direction, const uint8_t* data, size_t size)
+{
+    if (!m_file)
+    {
+        return;
+    }
+
+    const uint32_t flags = direction == WireDirection::Rx ? kFlagInbound : kFlagOutbound;
+
+    m_block.clear();
+    put<uint32_t>(m_block, kEnhancedPacketBlock);
+    put<uint32_t>(m_block, 0);
+    put<uint32_t>(m_block, 0); // interface id
+    put<uint32_t>(m_block, static_cast<uint32_t>(timestampUs >> 32));
+    put<uint32_t>(m_block, static_cast<uint32_t>(timestampUs));
+    put<uint32_t>(m_block, static_cast<uint32_t>(size));
+    put<uint32_t>(m_block, static_cast<uint32_t>(size));
+    m_block.insert(m_block.end(), data, data + size);
+    m_block.resize(padded(m_block.size()), 0);
+    putOption(m_block, kOptionEpbFlags, &flags, sizeof(flags));
+    putOption(m_block, kOptionEnd, nullptr, 0);
+    finishBlock(m_block);
+
+    std::fwrite(m_block.data(), 1, m_block.size(), m_file);
+    std::fflush(m_file);
+}
+
+bool WireCaptureReader::open(const std::string& path)
+{
+    m_content.clear();
+    m_offset = 0;
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    uint8_t buffer[4096];
+    size_t  read = 0;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        m_content.insert(m_content.end(), buffer, buffer + read);
+    }
+    std::fclose(file);
+
+    // only captures written on a little-endian host are expected
+    return m_content.size() >= kBlockFraming + sizeof(uint32_t) &&
+           get<uint32_t>(m_content.data()) == kSectionHeaderBlock &&
+           get<uint32_t>(m_content.data() + 8) == kByteOrderMagic;
+}
+
+bool WireCaptureReader::next(WireRecord& record)
+{
+    while (m_offset + kBlockFraming <= m_content.size())
+    {
+        const uint8_t* block  = m_content.data() + m_offset;
+        const uint32_t type   = get<uint32_t>(block);
+        const uint32_t length = get<uint32_t>(block + 4);
+        if (length < kBlockFraming || length % 4 != 0 || m_offset + length > m_content.size())
+        {
+            return false;
+        }
+        m_offset += length;
+
+        if (type != kEnhancedPacketBlock)
+        {
+            continue;
+        }
+
+        if (length < kBlockFraming + kPacketHeader)
+        {
+            return false;
+        }
+
+        const uint8_t* body     = block + 8;
+        const uint64_t high     = get<uint32_t>(body + 4);
+        const uint64_t low      = get<uint32_t>(body + 8);
+        const uint32_t captured = get<uint32_t>(body + 12);
+        const size_t   options  = 8 + kPacketHeader + padded(captured);
+        if (options + sizeof(uint32_t) > length)
+        {
+            return false;
+        }
+
+        record.timestampUs = (high << 32) | low;
+        record.direction   = WireDirection::Rx;
+        record.data.assign(body + kPacketHeader, body + kPacketHeader + captured);
+
+        // walk the options for epb_flags
+        for (size_t pos = options; pos + 4 <= length - sizeof(uint32_t);)
+        {
+            const uint16_t code      = get<uint16_t>(block + pos);
+            const uint16_t optLength = get<uint16_t>(block + pos + 2);
+            if (code == kOptionEnd)
+            {
+                break;
+            }
+            if (code == kOptionEpbFlags && optLength == sizeof(uint32_t))
+            {
+                const uint32_t flags = get<uint32_t>(block + pos + 4);
+                record.direction     = (flags & 0x3) == kFlagOutbound ? WireDirection::Tx : WireDirection::Rx;
+            }
+            pos += 4 + padded(optLength);
+        }
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Serial traffic capture in pcapng format.
+//
+// One interface with LINKTYPE_USER0, microsecond timestamps taken from a monotonic
+// clock (only their differences are meaningful) and the direction stored in the
+// epb_flags option, so captures open in Wireshark as well.
+enum class WireDirection : uint8_t
+{
+    Rx,
+    Tx
+};
+
+struct WireRecord
+{
+    uint64_t             timestampUs{0};
+    WireDirection        direction{WireDirection::Rx};
+    std::vector<uint8_t> data;
+};
+
+// Append-only writer, every record is flushed so a crash loses nothing that was written
+class WireCaptureWriter
+{
+public:
+    WireCaptureWriter() = default;
+    ~WireCaptureWriter();
+
+    WireCaptureWriter(const WireCaptureWriter&)            = delete;
+    WireCaptureWriter& operator=(const WireCaptureWriter&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    void write(uint64_t timestampUs, WireDirection direction, const uint8_t* data, size_t size);
+
+private:
+    void writeHeader();
+
+    std::FILE*           m_file{nullptr};
+    std::vector<uint8_t> m_block; // reused for every record
+};
+
+// Reads captures produced by WireCaptureWriter
+class WireCaptureReader
+{
+public:
+    bool open(const std::string& path);
+
+    // false at the end of the file or on a damaged block
+    bool next(WireRecord& record);
+
+private:
+    std::vector<uint8_t> m_content;
+    size_t               m_offset{0};
+};
@@ -0,0 +1,198 @@
+#include "logger.h"
+
+#include <ctime>
+
+namespace
+{
+
+const char* levelTag(LogLevel level)
+{
+    switch (level)
+    {
+        case LogLevel::Info:
+            return "INF";
+        case LogLevel::Warning:
+            return "WRN";
+        case LogLevel::Error:
+            return "ERR";
+        case LogLevel::Off:
+            break;
+    }
+    return "???";
+}
+
+}
+
+Logger& Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : m_records(std::make_unique<std::array<Record, kCapacity>>()), m_start(std::chrono::steady_clock::now())
+{
+    for (size_t i = 0; i < kCapacity; ++i)
+    {
+        (*m_records)[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_writer = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger()
+{
+    m_stop.store(true, std::memory_order_release);
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+    m_writer.join();
+}
+
+void Logger::setOutput(std::FILE* out, std::FILE* err)
+{
+    m_out.store(out, std::memory_order_release);
+    m_err.store(err, std::memory_order_release);
+}
+
+uint64_t Logger::elapsedUs() const
+{
+    const auto elapsed = std::chrono::steady_clock::now() - m_start;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+void Logger::push(LogLevel level, uint64_t timestampUs, const char* text, size_t size)
+{
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Record&        record   = (*m_records)[pos & (kCapacity - 1)];
+        const size_t   sequence = record.sequence.load(std::memory_order_acquire);
+        const intptr_t diff     = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                record.timestampUs = timestampUs;
+                record.level       = level;
+                record.size        = static_cast<uint16_t>(std::min(size, kMaxMessage));
+                std::char_traits<char>::copy(record.text, text, record.size);
+                record.sequence.store(pos + 1, std::memory_order_release);
+
+                // only the record the writer is parked on has to wake it, pairs with the fence in run()
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_dequeuePos.load(std::memory_order_relaxed) == pos)
+                {
+                    m_wakeups.fetch_add(1, std::memory_order_release);
+                    m_wakeups.notify_one();
+                }
+                return;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the writer is a full ring behind, losing a line beats blocking the caller
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::flush()
+{
+    const size_t target  = m_enqueuePos.load(std::memory_order_acquire);
+    size_t       written = m_dequeuePos.load(std::memory_order_acquire);
+    while (written < target)
+    {
+        m_dequeuePos.wait(written, std::memory_order_acquire);
+        written = m_dequeuePos.load(std::memory_order_acquire);
+    }
+}
+
+void Logger::run()
+{
+    {
+        const std::time_t now = std::time(nullptr);
+        char              started[32];
+        std::strftime(started, sizeof(started), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+        std::fprintf(m_out.load(std::memory_order_acquire), "[%6u.%06u] /INF: Log started at %s\n", 0u, 0u, started);
+    }
+
+    for (;;)
+    {
+        const uint32_t wakeups = m_wakeups.load(std::memory_order_acquire);
+
+        bool wrote = false;
+        while (writeNext())
+        {
+            wrote = true;
+        }
+
+        const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != m_reportedDrops)
+        {
+            std::fprintf(m_err.load(std::memory_order_acquire),
+                         "[%6llu.%06llu] /WRN: %llu log records dropped\n",
+                         static_cast<unsigned long long>(elapsedUs() / 1000000),
+                         static_cast<unsigned long long>(elapsedUs() % 1000000),
+                         static_cast<unsigned long long>(dropped - m_reportedDrops));
+            m_reportedDrops = dropped;
+            wrote           = true;
+        }
+
+        if (wrote)
+        {
+            std::fflush(m_out.load(std::memory_order_acquire));
+            std::fflush(m_err.load(std::memory_order_acquire));
+            m_dequeuePos.notify_all();
+            continue;
+        }
+
+        // checked only once the ring is empty, records pushed before the stop are not lost
+        if (m_stop.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        // either the producer of the next record sees our dequeue position and wakes us, or we see its record
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!nextReady())
+        {
+            m_wakeups.wait(wakeups, std::memory_order_acquire);
+        }
+    }
+}
+
+bool Logger::nextReady() const
+{
+    const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    return (*m_records)[pos & (kCapacity - 1)].sequence.load(std::memory_order_acquire) == pos + 1;
+}
+
+bool Logger::writeNext()
+{
+    if (!nextReady())
+    {
+        return false;
+    }
+
+    const size_t pos    = m_dequeuePos.load(std::memory_order_relaxed);
+    Record&      record = (*m_records)[pos & (kCapacity - 1)];
+
+    std::FILE* file = record.level == LogLevel::Error ? m_err.load(std::memory_order_acquire)
+                                                      : m_out.load(std::memory_order_acquire);
+    std::fprintf(file,
+                 "[%6llu.%06llu] /%s: %.*s\n",
+                 static_cast<unsigned long long>(record.timestampUs / 1000000),
+                 static_cast<unsigned long long>(record.timestampUs % 1000000),
+                 levelTag(record.level),
+                 static_cast<int>(record.size),
+                 record.text);
+
+    record.sequence.store(pos + kCapacity, std::memory_order_release);
+    m_dequeuePos.store(pos + 1, std::memory_order_release);
+    return true;
+}
@@ -1,15 +1,206 @@
 #pragma once
 
-#include <QDateTime>
-#include <QString>
-#include <iomanip>
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 
-#define LOG_INFO (std::cout << "[" << GetCurrentTime() << "] /INF: ")
-#define LOG_WRN (std::cout << "[" << GetCurrentTime() << "] /WRN: ")
-#define LOG_ERR (std::cerr << "[" << GetCurrentTime() << "] /ERR: ")
+// Asynchronous logger.
+//
+// LOG_INFO << ... formats into a stack buffer and hands the finished record to a lock-free
+// ring, a background thread writes it out. No allocation, lock or I/O on the calling thread; the
+// writer sleeps on an atomic wait while the ring is empty and is woken by the record that fills it.
+// Records below the runtime level are skipped before any formatting, records below
+// LOG_COMPILE_LEVEL are compiled out. Timestamps are monotonic, in microseconds since start.
+enum class LogLevel : uint8_t
+{
+    Info    = 0,
+    Warning = 1,
+    Error   = 2,
+    Off     = 3
+};
+
+// 0 keeps everything, 1 drops LOG_INFO, 2 keeps only LOG_ERR
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
 
-inline std::string GetCurrentTime()
+constexpr bool isLogCompiledIn(LogLevel level)
 {
-    return QDateTime::currentDateTime().toString("hh:mm:ss.zzz").toStdString();
-}
\ No newline at end of file
+    return level >= static_cast<LogLevel>(LOG_COMPILE_LEVEL);
+}
+
+class Logger
+{
+public:
+    // Longer messages are cut
+    static constexpr size_t kMaxMessage = 480;
+
+    static Logger& instance();
+
+    ~Logger();
+
+    Logger(const Logger&)            = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    void     setLevel(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return m_level.load(std::memory_order_relaxed); }
+
+    bool isEnabled(LogLevel level) const { return level >= m_level.load(std::memory_order_relaxed); }
+
+    // Info and warnings go to out, errors to err. stdout/stderr by default.
+    void setOutput(std::FILE* out, std::FILE* err);
+
+    uint64_t elapsedUs() const;
+
+    // Safe from any thread, drops the record when the writer fell behind
+    void push(LogLevel level, uint64_t timestampUs, const char* text, size_t size);
+
+    // Blocks until everything pushed so far has been written
+    void flush();
+
+    uint64_t droppedRecords() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    Logger();
+
+    void run();
+    bool writeNext();
+    bool nextReady() const;
+
+    struct Record
+    {
+        std::atomic<size_t> sequence{0};
+        uint64_t            timestampUs{0};
+        LogLevel            level{LogLevel::Info};
+        uint16_t            size{0};
+        char                text[kMaxMessage];
+    };
+
+    // Bounded multi-producer ring, one sequence number per cell (Vyukov)
+    static constexpr size_t kCapacity = 2048;
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+
+    std::unique_ptr<std::array<Record, kCapacity>> m_records;
+
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) std::atomic<size_t> m_dequeuePos{0};
+
+    std::atomic<LogLevel>   m_level{LogLevel::Info};
+    std::atomic<uint64_t>   m_dropped{0};
+    std::atomic<std::FILE*> m_out{stdout};
+    std::atomic<std::FILE*> m_err{stderr};
+    std::atomic<bool>       m_stop{false};
+    std::atomic<uint32_t>   m_wakeups{0}; // bumped to wake the writer, it waits on the value it last saw
+    uint64_t                m_reportedDrops{0}; // writer thread only
+
+    const std::chrono::steady_clock::time_point m_start;
+
+    std::thread m_writer;
+};
+
+// One log line, queued when the full expression ends
+class LogLine
+{
+public:
+    explicit LogLine(LogLevel level) : m_level(level), m_timestampUs(Logger::instance().elapsedUs()) {}
+    ~LogLine() { Logger::instance().push(m_level, m_timestampUs, m_text, m_size); }
+
+    LogLine(const LogLine&)            = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    LogLine& operator<<(std::string_view text)
+    {
+        append(text.data(), text.size());
+        return *this;
+    }
+
+    LogLine& operator<<(const char* text) { return *this << std::string_view(text ? text : "(null)"); }
+    LogLine& operator<<(const std::string& text) { return *this << std::string_view(text); }
+
+    LogLine& operator<<(char c)
+    {
+        append(&c, 1);
+        return *this;
+    }
+
+    LogLine& operator<<(bool value) { return *this << (value ? '1' : '0'); }
+
+    template <typename T>
+        requires(std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>)
+    LogLine& operator<<(T value)
+    {
+        // like std::ostream, byte-sized integers are characters
+        if constexpr (sizeof(T) == 1)
+        {
+            return *this << static_cast<char>(value);
+        }
+        else
+        {
+            const auto result = std::to_chars(m_text + m_size, m_text + Logger::kMaxMessage, value, m_base);
+            m_size            = result.ec == std::errc() ? static_cast<size_t>(result.ptr - m_text) : m_size;
+            return *this;
+        }
+    }
+
+    LogLine& operator<<(double value)
+    {
+        // 6 significant digits, the std::ostream default
+        const auto result =
+            std::to_chars(m_text + m_size, m_text + Logger::kMaxMessage, value, std::chars_format::general, 6);
+        m_size = result.ec == std::errc() ? static_cast<size_t>(result.ptr - m_text) : m_size;
+        return *this;
+    }
+
+    LogLine& operator<<(float value) { return *this << static_cast<double>(value); }
+
+    // std::hex and std::dec switch the integer base, std::endl is implied at the end of the line
+    LogLine& operator<<(std::ios_base& (*manipulator)(std::ios_base&))
+    {
+        if (manipulator == static_cast<std::ios_base& (*)(std::ios_base&)>(std::hex))
+        {
+            m_base = 16;
+        }
+        else if (manipulator == static_cast<std::ios_base& (*)(std::ios_base&)>(std::dec))
+        {
+            m_base = 10;
+        }
+        return *this;
+    }
+
+    LogLine& operator<<(std::ostream& (*)(std::ostream&)) { return *this; }
+
+private:
+    void append(const char* data, size_t size)
+    {
+        const size_t count = std::min(size, Logger::kMaxMessage - m_size);
+        std::char_traits<char>::copy(m_text + m_size, data, count);
+        m_size += count;
+    }
+
+    LogLevel m_level;
+    uint64_t m_timestampUs;
+    int      m_base{10};
+    size_t   m_size{0};
+    char     m_text[Logger::kMaxMessage];
+};
+
+#define LOG_AT(level)                                                    \
+    if (!isLogCompiledIn(level) || !Logger::instance().isEnabled(level)) \
+    {                                                                    \
+    }                                                                    \
+    else                                                                 \
+        LogLine(level)
+
+#define LOG_INFO LOG_AT(LogLevel::Info)
+#define LOG_WRN  LOG_AT(LogLevel::Warning)
+#define LOG_ERR  LOG_AT(LogLevel::Error)
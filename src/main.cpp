@@ -1,18 +1,96 @@
 #include <QApplication>
+#include <QCommandLineParser>
 
 #include "KeyboardController.h"
 #include "MainWindow.h"
 #include "SerialPortModel.h"
+#include "Tracer.h"
+#include "logger.h"
 
 int main(int argc, char* argv[])
 {
     QApplication app(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+
+    const QCommandLineOption portOption("port", "Connect to <port> or tcp://host:port without probing.", "port");
+    const QCommandLineOption baudOption("baud", "Baud rate for --port, 115200 by default.", "baud");
+    const QCommandLineOption captureOption("capture", "Record serial traffic to a pcapng <file>.", "file");
+    const QCommandLineOption replayOption("replay", "Play a recorded <file> instead of opening a port.", "file");
+    const QCommandLineOption replayFastOption("replay-fast", "Replay as fast as possible, ignoring recorded timing.");
+    const QCommandLineOption metricsOption("metrics", "Append link metrics as JSON lines to <file>.", "file");
+    const QCommandLineOption metricsIntervalOption(
+        "metrics-interval", "Period of the --metrics dump in milliseconds, 1000 by default.", "ms");
+    const QCommandLineOption latencyExportOption(
+        "latency-export", "Write click to LED latency histograms of every session to <dir>.", "dir");
+    const QCommandLineOption traceOption(
+        "trace", "Record a Chrome/Perfetto trace of the command lifecycle to <file>.", "file");
+    const QCommandLineOption logLevelOption("log-level", "Lowest logged level: info, warning, error or off.", "level");
+    parser.addOption(portOption);
+    parser.addOption(baudOption);
+    parser.addOption(captureOption);
+    parser.addOption(replayOption);
+    parser.addOption(replayFastOption);
+    parser.addOption(metricsOption);
+    parser.addOption(metricsIntervalOption);
+    parser.addOption(latencyExportOption);
+    parser.addOption(traceOption);
+    parser.addOption(logLevelOption);
+    parser.process(app);
+
+    const QString logLevel = parser.value(logLevelOption);
+    if (logLevel == "warning")
+    {
+        Logger::instance().setLevel(LogLevel::Warning);
+    }
+    else if (logLevel == "error")
+    {
+        Logger::instance().setLevel(LogLevel::Error);
+    }
+    else if (logLevel == "off")
+    {
+        Logger::instance().setLevel(LogLevel::Off);
+    }
+
+    SerialPortConnectionManager::PortOverride portOverride;
+    portOverride.portName = parser.value(portOption);
+    if (parser.isSet(baudOption))
+    {
+        bool      ok       = false;
+        const int baudRate = parser.value(baudOption).toInt(&ok);
+        if (ok && baudRate > 0)
+        {
+            portOverride.baudRate = baudRate;
+        }
+    }
+    portOverride.replayFile  = parser.value(replayOption);
+    portOverride.replaySpeed = parser.isSet(replayFastOption) ? ReplayTransport::Speed::Maximum
+                                                               : ReplayTransport::Speed::Original;
+
+    if (parser.isSet(traceOption))
+    {
+        Tracer::instance().start(parser.value(traceOption).toStdString());
+    }
+
     MainWindow         w;
     SerialPortModel    model;
-    KeyboardController controller(&model, &w);
+    if (parser.isSet(captureOption))
+    {
+        model.startCapture(parser.value(captureOption));
+    }
+    KeyboardController controller(&model, &w, portOverride);
+    controller.setLatencyExportDir(parser.value(latencyExportOption));
+    if (parser.isSet(metricsOption))
+    {
+        bool      ok         = false;
+        const int intervalMs = parser.value(metricsIntervalOption).toInt(&ok);
+        controller.startMetricsDump(parser.value(metricsOption), ok && intervalMs > 0 ? intervalMs : 1000);
+    }
 
     w.show();
 
-    return app.exec();
+    const int result = app.exec();
+    Tracer::instance().stop();
+    return result;
 }
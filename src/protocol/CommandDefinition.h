@@ -4,17 +4,58 @@
 
 enum class Command : uint8_t
 {
-    None               = 0x00,
-    Echo               = 0x01,
-    ButtonPressed      = 0x02,
-    ButtonReleased     = 0x03,
-    ModeCheckKeyboard  = 0x04,
-    ModeRun            = 0x05,
-    ModeConfigure      = 0x06,
-    ModeDiodeConfig    = 0x07,
-    ModeDiodeConfigDel = 0x08,
-    ModeDiodeClear     = 0x09,
-    DiodePressed       = 0x0A,
-    DiodeReleased      = 0x0B,
-    StatusUpdate       = 0x0C
+    None                 = 0x00,
+    Echo                 = 0x01,
+    ButtonPressed        = 0x02,
+    ButtonReleased       = 0x03,
+    ModeCheckKeyboard    = 0x04,
+    ModeRun              = 0x05,
+    ModeConfigure        = 0x06,
+    ModeDiodeConfig      = 0x07,
+    ModeDiodeConfigDel   = 0x08,
+    ModeDiodeClear       = 0x09,
+    DiodePressed         = 0x0A,
+    DiodeReleased        = 0x0B,
+    StatusUpdate         = 0x0C,
+    ModeDiodeConfigBatch = 0x0D, // DiodeBatchPayload, requires PROTOCOL_CAP_DIODE_BATCH
+    DiodeDigest          = 0x0E  // replied with DiodeDigestPayload, requires PROTOCOL_CAP_DIODE_DIGEST
 };
+
+// Used in logs and traces
+constexpr const char* command_name(Command command)
+{
+    switch (command)
+    {
+        case Command::None:
+            return "None";
+        case Command::Echo:
+            return "Echo";
+        case Command::ButtonPressed:
+            return "ButtonPressed";
+        case Command::ButtonReleased:
+            return "ButtonReleased";
+        case Command::ModeCheckKeyboard:
+            return "ModeCheckKeyboard";
+        case Command::ModeRun:
+            return "ModeRun";
+        case Command::ModeConfigure:
+            return "ModeConfigure";
+        case Command::ModeDiodeConfig:
+            return "ModeDiodeConfig";
+        case Command::ModeDiodeConfigDel:
+            return "ModeDiodeConfigDel";
+        case Command::ModeDiodeClear:
+            return "ModeDiodeClear";
+        case Command::DiodePressed:
+            return "DiodePressed";
+        case Command::DiodeReleased:
+            return "DiodeReleased";
+        case Command::StatusUpdate:
+            return "StatusUpdate";
+        case Command::ModeDiodeConfigBatch:
+            return "ModeDiodeConfigBatch";
+        case Command::DiodeDigest:
+            return "DiodeDigest";
+    }
+    return "Unknown";
+}
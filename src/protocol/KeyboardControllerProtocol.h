@@ -2,6 +2,9 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <span>
+#include <string.h>
+#include <vector>
 
 #include "CommandDefinition.h"
 #include "PinsDefinition.h"
@@ -9,6 +12,34 @@
 // Start of Frame
 #define PROTOCOL_SOF 0xAA
 
+// Protocol revision reported in the Echo reply
+#define PROTOCOL_VERSION 1
+
+// Set in Packet::command when the first payload byte is a sequence number.
+// The device acknowledges such a frame with the same flag and sequence number.
+//
+// A frame whose ACK got lost is sent again with its original sequence number, possibly after
+// later frames were applied. The device therefore remembers the last PROTOCOL_SEQ_HISTORY
+// sequence numbers it applied together with their reply payload: a frame with a sequence
+// number and command from that history is acknowledged again with the same reply, but not
+// applied again. An unsequenced Echo starts a new session and clears the history.
+#define PROTOCOL_SEQ_FLAG 0x80
+
+// Sequence numbers a device remembers, the host never has more frames in flight
+#define PROTOCOL_SEQ_HISTORY 32
+
+// Device capability bits reported in EchoReplyPayload::capabilities
+#define PROTOCOL_CAP_SEQUENCE     0x01 // sequenced frames, several commands in flight
+#define PROTOCOL_CAP_DIODE_BATCH  0x02 // Command::ModeDiodeConfigBatch
+#define PROTOCOL_CAP_DIODE_DIGEST 0x04 // Command::DiodeDigest
+
+// FNV-1a, see diode_digest_add()
+#define PROTOCOL_DIODE_DIGEST_BASIS 0x811C9DC5u
+#define PROTOCOL_DIODE_DIGEST_PRIME 0x01000193u
+
+// Largest body Packet::length can describe: command + body + checksum <= 255
+#define PROTOCOL_MAX_PAYLOAD 253
+
 #pragma pack(push, 1)
 
 // Common packet structure
@@ -28,6 +59,30 @@ typedef struct
     Pins    leds[0];  // LED pin numbers (1..15)
 } StatusPayload;
 
+typedef struct
+{
+    uint8_t count;   // number of diodes in this frame
+    Pins    pins[0]; // anode/cathode pairs, added to the device diode table
+} DiodeBatchPayload;
+
+// Largest batch that fits Packet::length together with a sequence number:
+// command + seq + count + pins + checksum <= 255
+#define PROTOCOL_DIODE_BATCH_MAX ((255 - 4) / sizeof(Pins))
+
+// Echo reply payload, legacy devices reply with an empty payload
+typedef struct
+{
+    uint8_t version;      // PROTOCOL_VERSION
+    uint8_t capabilities; // PROTOCOL_CAP_* bits
+} EchoReplyPayload;
+
+// DiodeDigest reply payload, describes the device diode table
+typedef struct
+{
+    uint8_t  count;  // configured diodes
+    uint32_t digest; // little-endian, diode_digest_add() over the table
+} DiodeDigestPayload;
+
 #pragma pack(pop)
 
 static inline uint8_t calc_checksum(const uint8_t* data, size_t len)
@@ -40,6 +95,75 @@ static inline uint8_t calc_checksum(const uint8_t* data, size_t len)
     return (uint8_t)(sum & 0xFF);
 }
 
+// Folds one diode into a table digest. Starting from PROTOCOL_DIODE_DIGEST_BASIS, the diodes
+// are added in ascending (pin1, pin2) order, so equal tables give equal digests whatever order
+// they were configured in. Pins outside 1..15 are not part of the table.
+static inline uint32_t diode_digest_add(uint32_t digest, Pins pins)
+{
+    digest = (digest ^ pins.pin1) * PROTOCOL_DIODE_DIGEST_PRIME;
+    digest = (digest ^ pins.pin2) * PROTOCOL_DIODE_DIGEST_PRIME;
+    return digest;
+}
+
+static inline uint8_t command_to_byte(Command cmd, bool sequenced)
+{
+    return sequenced ? (uint8_t)((uint8_t)cmd | PROTOCOL_SEQ_FLAG) : (uint8_t)cmd;
+}
+
+static inline Command command_from_byte(uint8_t raw)
+{
+    return (Command)(raw & (uint8_t)~PROTOCOL_SEQ_FLAG);
+}
+
+static inline bool is_sequenced(uint8_t raw)
+{
+    return (raw & PROTOCOL_SEQ_FLAG) != 0;
+}
+
+// Frames prefix + payload behind raw_command. Returns an empty vector when the body does not fit
+// Packet::length, the bounds are checked before anything is copied.
+inline std::vector<uint8_t> build_frame(uint8_t                  raw_command,
+                                        std::span<const uint8_t> prefix,
+                                        std::span<const uint8_t> payload)
+{
+    const size_t body_size = prefix.size() + payload.size();
+    if (body_size > PROTOCOL_MAX_PAYLOAD)
+    {
+        return {};
+    }
+
+    std::vector<uint8_t> out_buffer;
+    out_buffer.reserve(offsetof(Packet, payload) + body_size + sizeof(uint8_t)); // + checksum
+    out_buffer.push_back(PROTOCOL_SOF);
+    out_buffer.push_back(static_cast<uint8_t>(body_size + 2)); // command + body + checksum
+    out_buffer.push_back(raw_command);
+    out_buffer.insert(out_buffer.end(), prefix.begin(), prefix.end());
+    out_buffer.insert(out_buffer.end(), payload.begin(), payload.end());
+    out_buffer.push_back(calc_checksum(out_buffer.data(), out_buffer.size()));
+
+    return out_buffer;
+}
+
+inline std::vector<uint8_t> build_packet(Command cmd, std::span<const uint8_t> payload)
+{
+    return build_frame(command_to_byte(cmd, false), {}, payload);
+}
+
+inline std::vector<uint8_t> build_sequenced_packet(Command cmd, uint8_t seq, std::span<const uint8_t> payload)
+{
+    return build_frame(command_to_byte(cmd, true), std::span<const uint8_t>(&seq, 1), payload);
+}
+
+inline std::vector<uint8_t> build_packet(Command cmd, const uint8_t* payload, size_t payload_size)
+{
+    return build_packet(cmd, std::span<const uint8_t>(payload, payload_size));
+}
+
+inline std::vector<uint8_t> build_sequenced_packet(Command cmd, uint8_t seq, const uint8_t* payload, size_t payload_size)
+{
+    return build_sequenced_packet(cmd, seq, std::span<const uint8_t>(payload, payload_size));
+}
+
 template <typename T>
 std::vector<uint8_t> build_packet_for_cmd(Command cmd, const T& payload)
 {
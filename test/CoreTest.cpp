@@ -0,0 +1,431 @@
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QVector>
+#include <initializer_list>
+#include <vector>
+
+#include "DiodeSyncService.h"
+#include "FrameParser.h"
+#include "KeyboardControllerProtocol.h"
+#include "LoopbackDevice.h"
+#include "LoopbackHarness.h"
+#include "PinMatrix.h"
+#include "ProjectIO.h"
+#include "SerialPortModel.h"
+#include "StatusCoalescer.h"
+
+namespace
+{
+
+// Returns once the device has received nothing for quietMs, no command is left in flight or waiting for a retry
+bool waitForQuietLink(const LoopbackDevice& device, int quietMs)
+{
+    uint64_t      frames = device.simulator().stats().framesReceived;
+    QElapsedTimer quiet;
+    quiet.start();
+    return spinUntil(
+        [&]()
+        {
+            const uint64_t received = device.simulator().stats().framesReceived;
+            if (received != frames)
+            {
+                frames = received;
+                quiet.restart();
+            }
+            return quiet.elapsed() >= quietMs;
+        });
+}
+
+PinMatrix::Set tableOf(const QVector<Pins>& diodes)
+{
+    PinMatrix::Set table;
+    for (const Pins& pins : diodes)
+    {
+        table.set(PinMatrix::indexOf(pins.pin1, pins.pin2));
+    }
+    return table;
+}
+
+std::vector<uint8_t> concat(std::initializer_list<std::vector<uint8_t>> parts)
+{
+    std::vector<uint8_t> out;
+    for (const auto& part : parts)
+    {
+        out.insert(out.end(), part.begin(), part.end());
+    }
+    return out;
+}
+
+} // namespace
+
+class CoreTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void checksum();
+    void buildPacket();
+    void buildSequencedPacket();
+    void buildPacketRejectsOversizedPayload();
+
+    void frameParserByteByByte();
+    void frameParserSkipsGarbageAndBadChecksums();
+
+    void diodeSyncReset();
+    void diodeSyncUpdates();
+    void diodeSyncWithoutBatches();
+    void diodeSyncSkipsMatchingTable();
+    void diodeSyncResendsChangedTable();
+    void diodeSyncSurvivesLostAcks();
+    void diodeSyncDeleteBehindPendingBatch();
+
+    void statusCoalescerClearsShortPress();
+
+    void projectRoundTrip();
+};
+
+void CoreTest::checksum()
+{
+    const uint8_t data[] = {0xAA, 0x04, 0x07, 0x03, 0x05};
+    QCOMPARE(calc_checksum(data, sizeof(data)), uint8_t{0xBD});
+    QCOMPARE(calc_checksum(data, 0), uint8_t{0});
+
+    // the sum wraps at 8 bits
+    const std::vector<uint8_t> ones(300, 0xFF);
+    QCOMPARE(calc_checksum(ones.data(), ones.size()), static_cast<uint8_t>(300 * 0xFF));
+}
+
+void CoreTest::buildPacket()
+{
+    const Pins pins{3, 5};
+    const auto frame = build_packet(Command::ModeDiodeConfig, &pins.pin1, sizeof(pins));
+    QCOMPARE(frame, (std::vector<uint8_t>{0xAA, 0x04, 0x07, 0x03, 0x05, 0xBD}));
+
+    // the typed and the raw builders agree
+    QCOMPARE(build_packet_for_cmd(Command::ModeDiodeConfig, pins), frame);
+    QCOMPARE(build_packet_for_cmd(Command::Echo), build_packet(Command::Echo, nullptr, 0));
+    QCOMPARE(build_packet(Command::Echo, nullptr, 0), (std::vector<uint8_t>{0xAA, 0x02, 0x01, 0xAD}));
+}
+
+void CoreTest::buildSequencedPacket()
+{
+    const Pins pins{3, 5};
+    const auto frame = build_sequenced_packet(Command::ModeDiodeConfig, 0x2A, &pins.pin1, sizeof(pins));
+    QCOMPARE(frame, (std::vector<uint8_t>{0xAA, 0x05, 0x87, 0x2A, 0x03, 0x05, 0x68}));
+
+    QVERIFY(is_sequenced(frame[offsetof(Packet, command)]));
+    QCOMPARE(command_from_byte(frame[offsetof(Packet, command)]), Command::ModeDiodeConfig);
+    QVERIFY(!is_sequenced(command_to_byte(Command::ModeDiodeConfig, false)));
+}
+
+void CoreTest::buildPacketRejectsOversizedPayload()
+{
+    const std::vector<uint8_t> payload(PROTOCOL_MAX_PAYLOAD + 1, 0x11);
+    QVERIFY(build_packet(Command::ModeDiodeConfigBatch, payload.data(), payload.size()).empty());
+
+    // SOF and length in front of Packet::length bytes, the sequence number takes one payload byte
+    QCOMPARE(build_packet(Command::ModeDiodeConfigBatch, payload.data(), PROTOCOL_MAX_PAYLOAD).size(), size_t{257});
+    QVERIFY(build_sequenced_packet(Command::ModeDiodeConfigBatch, 1, payload.data(), PROTOCOL_MAX_PAYLOAD).empty());
+}
+
+void CoreTest::frameParserByteByByte()
+{
+    const Pins pins{7, 9};
+    const auto stream = concat({build_packet(Command::Echo, nullptr, 0),
+                                build_sequenced_packet(Command::ModeDiodeConfig, 4, &pins.pin1, sizeof(pins)),
+                                build_packet(Command::ButtonPressed, &pins.pin1, sizeof(pins))});
+
+    FrameParser                       parser;
+    std::vector<std::vector<uint8_t>> frames;
+    for (uint8_t byte : stream)
+    {
+        QCOMPARE(parser.feed(&byte, 1), size_t{1});
+        parser.drain([&frames](std::span<const uint8_t> frame) { frames.emplace_back(frame.begin(), frame.end()); });
+    }
+
+    QCOMPARE(frames.size(), size_t{3});
+    QCOMPARE(frames[0], build_packet(Command::Echo, nullptr, 0));
+    QCOMPARE(frames[1], build_sequenced_packet(Command::ModeDiodeConfig, 4, &pins.pin1, sizeof(pins)));
+    QCOMPARE(frames[2], build_packet(Command::ButtonPressed, &pins.pin1, sizeof(pins)));
+    QCOMPARE(parser.size(), size_t{0});
+    QCOMPARE(parser.skippedBytes(), uint64_t{0});
+    QCOMPARE(parser.checksumErrors(), uint64_t{0});
+}
+
+void CoreTest::frameParserSkipsGarbageAndBadChecksums()
+{
+    auto corrupted = build_packet(Command::ModeRun, nullptr, 0);
+    corrupted.back() ^= 0x01;
+
+    const auto stream =
+        concat({{0x00, 0x13, 0x37}, corrupted, build_packet(Command::ModeConfigure, nullptr, 0), {0x55}});
+
+    FrameParser          parser;
+    std::vector<Command> commands;
+    QCOMPARE(parser.feed(stream.data(), stream.size()), stream.size());
+    parser.drain(
+        [&commands](std::span<const uint8_t> frame)
+        { commands.push_back(command_from_byte(frame[offsetof(Packet, command)])); });
+
+    QCOMPARE(commands, std::vector<Command>{Command::ModeConfigure});
+    QCOMPARE(parser.checksumErrors(), uint64_t{1});
+    QCOMPARE(parser.skippedBytes(), uint64_t{3});
+
+    // a trailing byte shorter than a frame waits for more input
+    QCOMPARE(parser.size(), size_t{1});
+}
+
+void CoreTest::diodeSyncReset()
+{
+    LoopbackDevice   device;
+    SerialPortModel  model;
+    DiodeSyncService sync(&model);
+    QVERIFY(connectTo(device, model));
+    sync.handleConnectionEstablished();
+
+    QVector<Pins> diodes;
+    for (int i = 0; i < PinMatrix::kSize; i += 2)
+    {
+        diodes.append(PinMatrix::pinsAt(i));
+    }
+
+    sync.reset(diodes);
+    QVERIFY(waitForDevice(model));
+    QCOMPARE(device.simulator().diodes().count(), static_cast<size_t>(diodes.size()));
+
+    // a reset replaces the table, diodes missing from the new one are gone from the device
+    sync.reset({Pins{1, 2}, Pins{15, 15}});
+    QVERIFY(waitForDevice(model));
+    QCOMPARE(device.simulator().diodes(), tableOf({Pins{1, 2}, Pins{15, 15}}));
+}
+
+void CoreTest::diodeSyncUpdates()
+{
+    LoopbackDevice   device;
+    SerialPortModel  model;
+    DiodeSyncService sync(&model);
+    QVERIFY(connectTo(device, model));
+    sync.handleConnectionEstablished();
+
+    sync.reset({Pins{1, 1}, Pins{2, 2}});
+    sync.upsert(Pins{3, 3});
+    sync.remove(Pins{1, 1});
+    sync.upsert(Pins{4, 4});
+    sync.remove(Pins{4, 4});
+    QVERIFY(waitForDevice(model));
+    QCOMPARE(device.simulator().diodes(), tableOf({Pins{2, 2}, Pins{3, 3}}));
+}
+
+void CoreTest::diodeSyncWithoutBatches()
+{
+    SimulatorOptions options;
+    options.capabilities = 0;
+
+    LoopbackDevice   device(options);
+    SerialPortModel  model;
+    DiodeSyncService sync(&model);
+    QVERIFY(connectTo(device, model));
+    QCOMPARE(model.deviceCapabilities(), uint8_t{0});
+    sync.handleConnectionEstablished();
+
+    sync.reset({Pins{5, 6}, Pins{6, 5}, Pins{7, 7}});
+    sync.remove(Pins{6, 5});
+    QVERIFY(waitForDevice(model));
+    QCOMPARE(device.simulator().diodes(), tableOf({Pins{5, 6}, Pins{7, 7}}));
+}
+
+void CoreTest::diodeSyncSkipsMatchingTable()
+{
+    LoopbackDevice   device;
+    SerialPortModel  model;
+    DiodeSyncService sync(&model);
+    QVERIFY(connectTo(device, model));
+    sync.handleConnectionEstablished();
+
+    sync.reset({Pins{8, 9}, Pins{9, 8}});
+    QVERIFY(waitForDevice(model));
+
+    // the device kept its table through the reconnect, only the digest query goes out
+    const uint64_t before = device.simulator().stats().framesReceived;
+    sync.handleConnectionLost();
+    sync.handleConnectionEstablished();
+    QVERIFY(waitForDevice(model));
+    QCOMPARE(device.simulator().stats().framesReceived - before, uint64_t{2}); // DiodeDigest and the Echo
+    QCOMPARE(device.simulator().diodes(), tableOf({Pins{8, 9}, Pins{9, 8}}));
+}
+
+void CoreTest::diodeSyncResendsChangedTable()
+{
+    LoopbackDevice   device;
+    SerialPortModel  model;
+    DiodeSyncService sync(&model);
+    QVERIFY(connectTo(device, model));
+    sync.handleConnectionEstablished();
+
+    sync.reset({Pins{8, 9}});
+    QVERIFY(waitForDevice(model));
+
+    // edits while disconnected are not sent, the digest differs and the full table goes out
+    sync.handleConnectionLost();
+    sync.upsert(Pins{10, 11});
+    sync.remove(Pins{8, 9});
+    QCOMPARE(device.simulator().diodes(), tableOf({Pins{8, 9}}));
+
+    sync.handleConnectionEstablished();
+    QVERIFY(spinUntil([&device]() { return device.simulator().diodes() == tableOf({Pins{10, 11}}); }));
+}
+
+void CoreTest::diodeSyncSurvivesLostAcks()
+{
+    // A frame whose ACK got lost is sent again after later frames were applied. A ModeDiodeClear
+    // applied a second time would wipe the diodes of the batches behind it, the device has to
+    // acknowledge the repeat without applying it.
+    SimulatorOptions options;
+    options.ackDropRate = 0.3;
+    options.seed        = 5;
+
+    LoopbackDevice   device(options);
+    SerialPortModel  model;
+    DiodeSyncService sync(&model);
+    model.setTimingBounds({.minAckTimeoutMs = 10, .maxAckTimeoutMs = 40});
+    model.setRetryPolicy({.maxRetries = 10, .maxBackoffMs = 80});
+    QVERIFY(connectTo(device, model));
+    sync.handleConnectionEstablished();
+
+    QVector<Pins> even;
+    QVector<Pins> odd;
+    for (int i = 0; i < PinMatrix::kSize; ++i)
+    {
+        (i % 2 == 0 ? even : odd).append(PinMatrix::pinsAt(i));
+    }
+
+    for (int round = 0; round < 10; ++round)
+    {
+        const QVector<Pins>& diodes = round % 2 == 0 ? even : odd;
+        sync.reset(diodes);
+        QVERIFY(waitForQuietLink(device, 300));
+        QCOMPARE(device.simulator().diodes(), tableOf(diodes));
+    }
+
+    QVERIFY(device.simulator().stats().acksDropped > 0);
+    QVERIFY(device.simulator().stats().framesRepeated > 0);
+}
+
+void CoreTest::diodeSyncDeleteBehindPendingBatch()
+{
+    LoopbackDevice   device;
+    SerialPortModel  model;
+    DiodeSyncService sync(&model);
+    QVERIFY(connectTo(device, model));
+    sync.handleConnectionEstablished();
+    QVERIFY(waitForDevice(model));
+
+    // with one frame in flight the second reset's Clear and batch are still queued when the edits arrive
+    model.setSendWindow(1);
+    sync.reset({Pins{4, 5}});
+    sync.reset({Pins{6, 7}});
+    sync.remove(Pins{6, 7});
+    sync.upsert(Pins{6, 7});
+    sync.remove(Pins{6, 7});
+    QVERIFY(waitForDevice(model));
+    QVERIFY(device.simulator().diodes().none());
+}
+
+void CoreTest::statusCoalescerClearsShortPress()
+{
+    struct Snapshot
+    {
+        Pins              pins;
+        std::vector<Pins> leds;
+    };
+
+    StatusCoalescer       coalescer(20);
+    std::vector<Snapshot> snapshots;
+    QObject::connect(&coalescer,
+                     &StatusCoalescer::statusReady,
+                     [&snapshots](Pins pins, const LedList& leds)
+                     { snapshots.push_back({pins, std::vector<Pins>(leds.begin(), leds.end())}); });
+
+    // press and release before the first delivery, the device sends nothing more after the release
+    LedList lit;
+    lit.push_back(Pins{3, 4});
+    coalescer.push(Pins{3, 4}, lit);
+    coalescer.push(Pins{0, 0}, LedList{});
+
+    QVERIFY(spinUntil([&snapshots]() { return snapshots.size() == 2; }, 1000));
+    QTest::qWait(60);
+    QCOMPARE(snapshots.size(), size_t{2});
+
+    // the pulse is shown for one display frame, then the released state
+    QCOMPARE(snapshots[0].pins.pin1, uint8_t{3});
+    QCOMPARE(snapshots[0].leds.size(), size_t{1});
+    QCOMPARE(snapshots[1].pins.pin1, uint8_t{0});
+    QCOMPARE(snapshots[1].pins.pin2, uint8_t{0});
+    QVERIFY(snapshots[1].leds.empty());
+    QCOMPARE(coalescer.framesDelivered(), quint64{2});
+}
+
+void CoreTest::projectRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("round-trip.kbk");
+
+    Project project;
+    project.background = QImage(64, 32, QImage::Format_RGB32);
+    project.background.fill(Qt::darkGray);
+    project.background.setPixel(5, 7, qRgb(10, 200, 30));
+    for (int i = 0; i < 4; ++i)
+    {
+        ItemDef button(i * 10.0, i * 5.0, "#0000FF", false);
+        ItemDef led(i * 10.0, i * 5.0 + 100.0, "#00FF00", true);
+        button.p1 = led.p1 = i + 1;
+        button.p2 = led.p2 = 15 - i;
+        project.buttons.append(button);
+        project.leds.append(led);
+    }
+
+    QVERIFY(ProjectIO::save(path, project));
+
+    Project loaded;
+    QVERIFY(ProjectIO::load(path, loaded));
+
+    QCOMPARE(loaded.background.size(), project.background.size());
+    QCOMPARE(loaded.background.pixel(5, 7), project.background.pixel(5, 7));
+    QCOMPARE(loaded.background.pixel(0, 0), project.background.pixel(0, 0));
+
+    QCOMPARE(loaded.buttons.size(), project.buttons.size());
+    QCOMPARE(loaded.leds.size(), project.leds.size());
+    for (qsizetype i = 0; i < project.buttons.size(); ++i)
+    {
+        const ItemDef& expected = project.buttons[i];
+        const ItemDef& actual   = loaded.buttons[i];
+        QCOMPARE(actual.rect, expected.rect);
+        QCOMPARE(actual.color, expected.color);
+        QCOMPARE(actual.isCircular, expected.isCircular);
+        QCOMPARE(actual.p1, expected.p1);
+        QCOMPARE(actual.p2, expected.p2);
+    }
+    for (qsizetype i = 0; i < project.leds.size(); ++i)
+    {
+        const ItemDef& expected = project.leds[i];
+        const ItemDef& actual   = loaded.leds[i];
+        QCOMPARE(actual.rect, expected.rect);
+        QCOMPARE(actual.color, expected.color);
+        QCOMPARE(actual.isCircular, expected.isCircular);
+        QCOMPARE(actual.p1, expected.p1);
+        QCOMPARE(actual.p2, expected.p2);
+    }
+
+    // a truncated file is rejected, not half loaded
+    QFile file(path);
+    QVERIFY(file.resize(file.size() / 2));
+    Project truncated;
+    QVERIFY(!ProjectIO::load(path, truncated));
+}
+
+QTEST_GUILESS_MAIN(CoreTest)
+
+#include "CoreTest.moc"
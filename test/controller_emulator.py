@@ -1,4 +1,5 @@
 import argparse
+import collections
 import sys
 import threading
 import time
@@ -15,11 +16,20 @@ from protocol import (
     CMD_MODE_DIODE_CONFIG,
     CMD_MODE_DIODE_CONFIG_DEL,
     CMD_MODE_DIODE_CLEAR,
+    CMD_MODE_DIODE_CONFIG_BATCH,
+    CMD_DIODE_DIGEST,
     CMD_DIODE_PRESSED,
     CMD_DIODE_RELEASED,
-    Packet,         
+    PROTOCOL_VERSION,
+    PROTOCOL_SEQ_HISTORY,
+    CAP_SEQUENCE,
+    CAP_DIODE_BATCH,
+    CAP_DIODE_DIGEST,
+    Packet,
     Framer,
-    build_cmd_no_payload,
+    build_ack,
+    build_diode_digest_reply,
+    parse_diode_batch,
 )
 
 from states import (
@@ -40,6 +50,7 @@ class ControllerEmulator:
         check_interval_s: float = 0.2,
         verbose: bool = False,
         io: SerialPort | None = None,
+        capabilities: int = CAP_SEQUENCE | CAP_DIODE_BATCH | CAP_DIODE_DIGEST,
     ):
         self.port_name = port
         self.baud = baud
@@ -58,6 +69,11 @@ class ControllerEmulator:
         self._tx_lock = threading.Lock()
 
         self.check_interval_s = max(0.02, check_interval_s)
+        self.capabilities = capabilities
+        self.diodes: set[tuple[int, int]] = set()
+
+        # (seq, command) -> ACK payload of the last applied sequenced frames
+        self.seq_history: collections.OrderedDict[tuple[int, int], bytes] = collections.OrderedDict()
 
         self.state: BaseState = RunState()
 
@@ -118,23 +134,52 @@ class ControllerEmulator:
                 if self.verbose:
                     print(f"[ERR] TX failed: {e}", file=sys.stderr)
 
-    def _send_zero_ack(self, cmd: int, tag: str = "ACK-ZERO"):
-        frame = build_cmd_no_payload(cmd)
+    def _send_ack(self, pkt: Packet, tag: str = "ACK", payload: bytes = b""):
+        frame = build_ack(pkt.command, pkt.seq, payload)
+        if pkt.seq is not None:
+            tag = f"{tag} seq={pkt.seq}"
+            self.seq_history[(pkt.seq, pkt.command)] = payload
+            while len(self.seq_history) > PROTOCOL_SEQ_HISTORY:
+                self.seq_history.popitem(last=False)
         self._send_frame(frame, tag=tag)
 
+    def _repeat_ack(self, pkt: Packet) -> bool:
+        """ACKs a frame again without applying it when its seq was applied already (lost ACK)."""
+        payload = self.seq_history.get((pkt.seq, pkt.command))
+        if payload is None:
+            return False
+        if self.verbose:
+            print(f"[ACK] repeated cmd=0x{pkt.command:02X} seq={pkt.seq}", file=sys.stderr)
+        self._send_frame(build_ack(pkt.command, pkt.seq, payload), tag=f"REPEAT seq={pkt.seq}")
+        return True
+
     def _on_packet(self, pkt: Packet):
         cmd = pkt.command
 
+        if pkt.seq is None and cmd == CMD_ECHO:
+            # a new host session, its sequence numbers start over
+            self.seq_history.clear()
+        elif pkt.seq is not None and self._repeat_ack(pkt):
+            return
+
         if cmd == CMD_ECHO:
             if self.verbose:
                 print("[ECHO] request -> reply ACK", file=sys.stderr)
-            self._send_zero_ack(CMD_ECHO, tag="ECHO")
+            self._send_ack(pkt, tag="ECHO", payload=bytes([PROTOCOL_VERSION, self.capabilities]))
             return
 
         if cmd == CMD_MODE_DIODE_CLEAR:
             if self.verbose:
                 print("[DIODE_CLEAR] accepted -> reply with ACK", file=sys.stderr)
-            self._send_zero_ack(CMD_MODE_DIODE_CLEAR, tag="DIODE_CLEAR")
+            self.diodes.clear()
+            self._send_ack(pkt, tag="DIODE_CLEAR")
+            return
+
+        if cmd == CMD_DIODE_DIGEST and self.capabilities & CAP_DIODE_DIGEST:
+            reply = build_diode_digest_reply(self.diodes)
+            if self.verbose:
+                print(f"[DIODE_DIGEST] table size {reply[0]} -> reply {reply.hex(' ')}", file=sys.stderr)
+            self._send_ack(pkt, tag="DIODE_DIGEST", payload=reply)
             return
 
         if cmd == CMD_DIODE_PRESSED:
@@ -161,13 +206,24 @@ class ControllerEmulator:
             return
 
         if cmd == CMD_MODE_DIODE_CONFIG:
+            self.diodes.add((pkt.pin1, pkt.pin2))
             self._set_state(DiodeConfigState())
-            self._send_zero_ack(CMD_MODE_DIODE_CONFIG, tag="DIODE_CONFIG")
+            self._send_ack(pkt, tag="DIODE_CONFIG")
             return
 
         if cmd == CMD_MODE_DIODE_CONFIG_DEL:
+            self.diodes.discard((pkt.pin1, pkt.pin2))
             self._set_state(DiodeConfigDelState())
-            self._send_zero_ack(CMD_MODE_DIODE_CONFIG_DEL, tag="DIODE_CONFIG_DEL")
+            self._send_ack(pkt, tag="DIODE_CONFIG_DEL")
+            return
+
+        if cmd == CMD_MODE_DIODE_CONFIG_BATCH and self.capabilities & CAP_DIODE_BATCH:
+            batch = parse_diode_batch(pkt.payload)
+            self.diodes.update(batch)
+            if self.verbose:
+                print(f"[DIODE_BATCH] {len(batch)} diodes, table size {len(self.diodes)}", file=sys.stderr)
+            self._set_state(DiodeConfigState())
+            self._send_ack(pkt, tag="DIODE_BATCH")
             return
 
         self.state.handle_packet(pkt, self)
@@ -179,6 +235,8 @@ def main():
     ap.add_argument("--baud", type=int, default=115200, help="Baud rate")
     ap.add_argument("--check-interval", type=float, default=2.0,
                     help="Period (s) for CHECK mode step")
+    ap.add_argument("--legacy", action="store_true",
+                    help="Behave like old firmware: no capabilities, stop-and-wait ACKs only")
     ap.add_argument("-v", "--verbose", action="store_true", help="Verbose logs to stderr")
     args = ap.parse_args()
 
@@ -187,6 +245,7 @@ def main():
         args.baud,
         check_interval_s=args.check_interval,
         verbose=args.verbose,
+        capabilities=0 if args.legacy else CAP_SEQUENCE | CAP_DIODE_BATCH | CAP_DIODE_DIGEST,
     )
     try:
         emu.open()
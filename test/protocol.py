@@ -1,5 +1,6 @@
 from __future__ import annotations
 
+import struct
 from dataclasses import dataclass
 from typing import Callable, Iterable, List, Tuple
 
@@ -17,6 +18,26 @@ CMD_MODE_DIODE_CLEAR      = 0x09
 CMD_DIODE_PRESSED         = 0x0A
 CMD_DIODE_RELEASED        = 0x0B
 CMD_STATUS_UPDATE         = 0x0C
+CMD_MODE_DIODE_CONFIG_BATCH = 0x0D
+CMD_DIODE_DIGEST          = 0x0E
+
+PROTOCOL_VERSION = 1
+
+# Set in the command byte when the first payload byte is a sequence number
+PROTOCOL_SEQ_FLAG = 0x80
+
+# Sequence numbers a device remembers: a repeated one is ACKed again with the same reply but
+# not applied again. An unsequenced Echo clears the history (KeyboardControllerProtocol.h).
+PROTOCOL_SEQ_HISTORY = 32
+
+# Capability bits reported in the Echo reply
+CAP_SEQUENCE = 0x01
+CAP_DIODE_BATCH = 0x02
+CAP_DIODE_DIGEST = 0x04
+
+# FNV-1a over the diode table, see diode_digest_add() in KeyboardControllerProtocol.h
+DIODE_DIGEST_BASIS = 0x811C9DC5
+DIODE_DIGEST_PRIME = 0x01000193
 
 
 def calc_checksum(data: bytes) -> int:
@@ -27,6 +48,7 @@ def calc_checksum(data: bytes) -> int:
 class Packet:
     command: int
     payload: bytes
+    seq: int | None = None
 
     @property
     def pin1(self) -> int:
@@ -83,7 +105,15 @@ class Framer:
             cmd = frame[2]
             payload = frame[3:-1]  # exclude SOF, Length, Command, Checksum
 
-            self.on_packet(Packet(cmd, payload))
+            seq = None
+            if cmd & PROTOCOL_SEQ_FLAG:
+                if not payload:
+                    continue
+                cmd &= ~PROTOCOL_SEQ_FLAG & 0xFF
+                seq = payload[0]
+                payload = payload[1:]
+
+            self.on_packet(Packet(cmd, payload, seq))
 
 
 def build_packet(command: int, payload: bytes | Iterable[int] = b"") -> bytes:
@@ -104,10 +134,38 @@ def build_cmd_no_payload(command: int) -> bytes:
     return build_packet(command, b"")
 
 
+def build_ack(command: int, seq: int | None, payload: bytes = b"") -> bytes:
+    if seq is None:
+        return build_packet(command, payload)
+    return build_packet(command | PROTOCOL_SEQ_FLAG, bytes([seq & 0xFF]) + payload)
+
+
 def build_cmd_with_pins(command: int, pin1: int, pin2: int) -> bytes:
     return build_packet(command, [pin1, pin2])
 
 
+def parse_diode_batch(payload: bytes) -> List[Tuple[int, int]]:
+    if not payload:
+        return []
+    count = min(payload[0], (len(payload) - 1) // 2)
+    return [(payload[1 + 2 * i], payload[2 + 2 * i]) for i in range(count)]
+
+
+def diode_digest(diodes: Iterable[Tuple[int, int]]) -> Tuple[int, int]:
+    """(count, digest) of a diode table, pins outside 1..15 are not part of it."""
+    table = sorted((p1, p2) for (p1, p2) in set(diodes) if 1 <= p1 <= 15 and 1 <= p2 <= 15)
+    digest = DIODE_DIGEST_BASIS
+    for (p1, p2) in table:
+        digest = ((digest ^ p1) * DIODE_DIGEST_PRIME) & 0xFFFFFFFF
+        digest = ((digest ^ p2) * DIODE_DIGEST_PRIME) & 0xFFFFFFFF
+    return len(table), digest
+
+
+def build_diode_digest_reply(diodes: Iterable[Tuple[int, int]]) -> bytes:
+    count, digest = diode_digest(diodes)
+    return struct.pack("<BI", count & 0xFF, digest)
+
+
 def build_status(pin1: int, pin2: int, led_pairs: List[Tuple[int, int]]) -> bytes:
     leds_num = len(led_pairs) & 0xFF
     payload = bytearray([pin1 & 0xFF, pin2 & 0xFF, leds_num])